@@ -23,6 +23,7 @@ extern const std::map<es_respond_result_t, const std::string> g_respondResultToS
 
 std::string to_string(const es_string_token_t &esString);
 std::vector<std::string> paths_from_event(const es_message_t * const msg);
+std::vector<const es_file_t *> files_from_event(const es_message_t * const msg);
 std::any getDefaultESResponse(const es_message_t * const msg);
 
 // MARK: - Endpoint Security Logging
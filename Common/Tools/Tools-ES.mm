@@ -35,13 +35,17 @@ const inline std::map<es_event_type_t, const std::string> g_eventTypeToStrMap =
     {ES_EVENT_TYPE_AUTH_FILE_PROVIDER_UPDATE, "ES_EVENT_TYPE_AUTH_FILE_PROVIDER_UPDATE"},
     {ES_EVENT_TYPE_NOTIFY_EXCHANGEDATA, "ES_EVENT_TYPE_NOTIFY_EXCHANGEDATA"},
     {ES_EVENT_TYPE_AUTH_LINK, "ES_EVENT_TYPE_AUTH_LINK"},
+    {ES_EVENT_TYPE_NOTIFY_LINK, "ES_EVENT_TYPE_NOTIFY_LINK"},
     {ES_EVENT_TYPE_AUTH_MOUNT, "ES_EVENT_TYPE_AUTH_MOUNT"},
+    {ES_EVENT_TYPE_NOTIFY_MOUNT, "ES_EVENT_TYPE_NOTIFY_MOUNT"},
     {ES_EVENT_TYPE_AUTH_OPEN, "ES_EVENT_TYPE_AUTH_OPEN"},
     {ES_EVENT_TYPE_AUTH_READDIR, "ES_EVENT_TYPE_AUTH_READDIR"},
     {ES_EVENT_TYPE_AUTH_READLINK, "ES_EVENT_TYPE_AUTH_READLINK"},
     {ES_EVENT_TYPE_AUTH_RENAME, "ES_EVENT_TYPE_AUTH_RENAME"},
+    {ES_EVENT_TYPE_NOTIFY_RENAME, "ES_EVENT_TYPE_NOTIFY_RENAME"},
     {ES_EVENT_TYPE_AUTH_TRUNCATE, "ES_EVENT_TYPE_AUTH_TRUNCATE"},
     {ES_EVENT_TYPE_AUTH_UNLINK, "ES_EVENT_TYPE_AUTH_UNLINK"},
+    {ES_EVENT_TYPE_NOTIFY_UNLINK, "ES_EVENT_TYPE_NOTIFY_UNLINK"},
     {ES_EVENT_TYPE_NOTIFY_UNMOUNT, "ES_EVENT_TYPE_NOTIFY_UNMOUNT"},
     {ES_EVENT_TYPE_NOTIFY_WRITE, "ES_EVENT_TYPE_NOTIFY_WRITE"},
     // System
@@ -195,6 +199,69 @@ std::vector<std::string> paths_from_event(const es_message_t * const msg)
     return eventPaths;
 }
 
+/// Returns files whose paths are returned by paths_from_event() as they are.
+/// If any of the event paths is composed (directory + filename), returns nothing.
+std::vector<const es_file_t *> files_from_event(const es_message_t * const msg)
+{
+    std::vector<const es_file_t *> eventFiles;
+    if (msg == nullptr)
+        return eventFiles;
+
+    switch(msg->event_type) {
+        // File System
+        case ES_EVENT_TYPE_NOTIFY_ACCESS:
+            eventFiles.push_back(msg->event.access.target);
+            break;
+        case ES_EVENT_TYPE_AUTH_CHDIR:
+            eventFiles.push_back(msg->event.chdir.target);
+            break;
+        case ES_EVENT_TYPE_AUTH_CREATE:
+            if (msg->event.create.destination_type == ES_DESTINATION_TYPE_EXISTING_FILE)
+                eventFiles.push_back(msg->event.create.destination.existing_file);
+            break;
+        case ES_EVENT_TYPE_NOTIFY_CLOSE:
+            eventFiles.push_back(msg->event.close.target);
+            break;
+        case ES_EVENT_TYPE_AUTH_FILE_PROVIDER_MATERIALIZE:
+            eventFiles.push_back(msg->event.file_provider_materialize.source);
+            eventFiles.push_back(msg->event.file_provider_materialize.target);
+            break;
+        case ES_EVENT_TYPE_NOTIFY_EXCHANGEDATA:
+            eventFiles.push_back(msg->event.exchangedata.file1);
+            eventFiles.push_back(msg->event.exchangedata.file2);
+            break;
+        case ES_EVENT_TYPE_AUTH_OPEN:
+            eventFiles.push_back(msg->event.open.file);
+            break;
+        case ES_EVENT_TYPE_AUTH_READDIR:
+            eventFiles.push_back(msg->event.readdir.target);
+            break;
+        case ES_EVENT_TYPE_AUTH_READLINK:
+            eventFiles.push_back(msg->event.readlink.source);
+            break;
+        case ES_EVENT_TYPE_AUTH_RENAME:
+            if (msg->event.rename.destination_type == ES_DESTINATION_TYPE_EXISTING_FILE) {
+                eventFiles.push_back(msg->event.rename.source);
+                eventFiles.push_back(msg->event.rename.destination.existing_file);
+            }
+            break;
+        case ES_EVENT_TYPE_AUTH_TRUNCATE:
+            eventFiles.push_back(msg->event.truncate.target);
+            break;
+        case ES_EVENT_TYPE_AUTH_UNLINK:
+            eventFiles.push_back(msg->event.unlink.parent_dir);
+            eventFiles.push_back(msg->event.unlink.target);
+            break;
+        case ES_EVENT_TYPE_NOTIFY_WRITE:
+            eventFiles.push_back(msg->event.write.target);
+            break;
+        // CLONE, FILE_PROVIDER_UPDATE and LINK have composed (or plain string) paths
+        default:
+            break;
+    }
+    return eventFiles;
+}
+
 std::any getDefaultESResponse(const es_message_t * const msg)
 {
     if (msg == nullptr)
@@ -8,6 +8,7 @@
 #include <any>
 #include <bsm/libbsm.h>
 #include <EndpointSecurity/EndpointSecurity.h>
+#include <sys/fcntl.h>  // FREAD, FWRITE
 
 #include "../../../Common/Tools/Tools-ES.hpp"
 #include "../../../Common/Tools/Tools.hpp"
@@ -16,26 +17,17 @@
 #include "dropbox.hpp"
 #include "base.hpp"
 
-static Logger &g_logger = Logger::getInstance();
-
-const std::unordered_map<CloudProviderId, const std::string> g_cpToStr = {
-    {CloudProviderId::NONE,     "NONE"},
-    {CloudProviderId::ICLOUD,   "iCloud"},
-    {CloudProviderId::DROPBOX,  "Dropbox"},
-    {CloudProviderId::ONEDRIVE, "OneDrive"},
-};
+static_assert(FFLAG_READ == FREAD && FFLAG_WRITE == FWRITE && FFLAG_APPEND == FAPPEND && FFLAG_CREAT == O_CREAT,
+              "Policy fflags do not match the kernel ones.");
 
-bool CloudProvider::BundleIdIsAllowed(const std::string &bundleId) const
-{
-    return (std::find(allowedBundleIds.begin(), allowedBundleIds.end(), bundleId) != allowedBundleIds.end());
-}
+static Logger &g_logger = Logger::getInstance();
 
 std::any CloudProvider::HandleEvent(const std::string &bundleId, const std::vector<std::string> &cpPaths, const es_message_t * const msg) const
 {
     std::any ret = getDefaultESResponse(msg);
 
     const auto composeDebugMessage = [&]() {
-        std::string msgToPrint = "(" + g_blockLvlToStr.at(bl) + ") ";
+        std::string msgToPrint = (shadow ? "(SHADOW " : "(") + g_blockLvlToStr.at(bl) + ") ";
         msgToPrint += g_eventTypeToStrMap.at(msg->event_type) + " -";
         if (msg->action_type == ES_ACTION_TYPE_AUTH) {
             if (ret.type() == typeid(es_auth_result_t)) {
@@ -64,6 +56,10 @@ std::any CloudProvider::HandleEvent(const std::string &bundleId, const std::vect
         return msgToPrint;
     };
 
+    const auto toAuthResult = [](const bool allowed) {
+        return (allowed ? ES_AUTH_RESULT_ALLOW : ES_AUTH_RESULT_DENY);
+    };
+
     // Bundle is allowed, lets do it its job.
     if (BundleIdIsAllowed(bundleId)) {
         g_logger.log(LogLevel::INFO, DEBUG_ARGS, composeDebugMessage());
@@ -86,7 +82,7 @@ std::any CloudProvider::HandleEvent(const std::string &bundleId, const std::vect
         case ES_EVENT_TYPE_AUTH_READLINK:
         case ES_EVENT_TYPE_AUTH_CHDIR:
         case ES_EVENT_TYPE_AUTH_READDIR:
-            ret = AuthReadGeneral(bundleId);
+            ret = toAuthResult(AuthReadGeneral(bundleId));
             break;
         case ES_EVENT_TYPE_AUTH_FILE_PROVIDER_MATERIALIZE:
         case ES_EVENT_TYPE_AUTH_FILE_PROVIDER_UPDATE:
@@ -98,8 +94,16 @@ std::any CloudProvider::HandleEvent(const std::string &bundleId, const std::vect
         case ES_EVENT_TYPE_AUTH_RENAME:
         case ES_EVENT_TYPE_AUTH_CLONE:
         case ES_EVENT_TYPE_AUTH_UNLINK:
-            ret = AuthWriteGeneral(bundleId, cpPaths, msg);
+        {
+            // If it's not cloning within the cloud, the destination is outside of it.
+            const bool copiesOutOfCloud = (msg->event_type == ES_EVENT_TYPE_AUTH_CLONE
+                                           && cpPaths.size() == 1
+                                           && cpPaths[0] == to_string(msg->event.clone.source->path));
+            if (IsDropboxCacheAccess(bundleId, cpPaths))
+                g_logger.log(LogLevel::VERBOSE, DEBUG_ARGS, "Ignoring Dropbox process.");
+            ret = toAuthResult(AuthWriteGeneral(bundleId, cpPaths, copiesOutOfCloud));
             break;
+        }
         case ES_EVENT_TYPE_AUTH_OPEN:
             ret = AuthOpen(bundleId, cpPaths, msg->event.open.fflag);
             break;
@@ -117,113 +121,3 @@ std::any CloudProvider::HandleEvent(const std::string &bundleId, const std::vect
     g_logger.log(LogLevel::INFO, DEBUG_ARGS, composeDebugMessage());
     return ret;
 }
-
-std::vector<std::string> CloudProvider::FilterCloudFolders(const std::vector<std::string> &eventPaths) const
-{
-    std::vector<std::string> ret;
-    for (const auto &eventPath : eventPaths)
-        for (const auto &cpPath : paths)
-            if (eventPath.find(cpPath) != std::string::npos)
-                ret.push_back(eventPath);
-    return ret;
-}
-
-// MARK: - Private
-bool CloudProvider::ContainsDropboxCacheFolder(const std::vector<std::string> &eventPaths) const
-{
-    for (const auto &dropboxPath : paths) {
-        const std::string dropboxCache = dropboxPath + "/.dropbox.cache";
-
-        for (const auto &eventPath : eventPaths)
-            if (eventPath.find(dropboxCache) != std::string::npos)
-                return true;
-    }
-    return false;
-}
-
-// MARK: Callbacks
-/// Allows reading to everybody if in RONLY mode,
-/// otherwise blocks everything except whitelisted apps
-es_auth_result_t CloudProvider::AuthReadGeneral(const std::string &bundleId) const
-{
-    es_auth_result_t ret = ES_AUTH_RESULT_ALLOW;
-
-    // ALLOW the operation if not in FULL blocking mode
-    if (bl != BlockLevel::FULL)
-        return ret;
-
-    // Otherwise block everything except whitelisted apps
-    if (!BundleIdIsAllowed(bundleId))
-        ret = ES_AUTH_RESULT_DENY;
-
-    return ret;
-}
-
-/// Blocks all operations except whitelisted apps, and
-/// allows  content modifying operations  by dropbox in dropbox cache folders.
-es_auth_result_t CloudProvider::AuthWriteGeneral(const std::string &bundleId, const std::vector<std::string> &cpPaths, const es_message_t * const msg) const
-{
-    es_auth_result_t ret = ES_AUTH_RESULT_ALLOW;
-
-    if (BundleIdIsAllowed(bundleId))
-        return ret;
-
-    const std::string dropboxBundleId = "com.getdropbox.dropbox";
-    // If the operation is from/to one of Dropbox folders, allow it.
-    // !!!: we expect that the Dropbox cache folder is not accesible using Dropbox file explorer (which is true so far) so an user cannot do any mess there using the Dropbox app.
-    if (id == CloudProviderId::DROPBOX && bundleId == dropboxBundleId && ContainsDropboxCacheFolder(cpPaths)) {
-        g_logger.log(LogLevel::VERBOSE, DEBUG_ARGS, "Ignoring Dropbox process.");
-        return ret;
-    }
-
-    // If there is any restriction block the operation.
-    if (bl != BlockLevel::NONE)
-        ret = ES_AUTH_RESULT_DENY;
-
-    // But in case of CLONE operation...check the direction of the operation.
-    if (bl == BlockLevel::RONLY && msg->event_type == ES_EVENT_TYPE_AUTH_CLONE) {
-        // If it's not cloning within the cloud check the direction.
-        if (cpPaths.size() == 1
-            && cpPaths[0] == to_string(msg->event.clone.source->path)) {
-            // In RONLY mode, we are interested if it the destination is outside of the cloud so we should not block it.
-            ret = ES_AUTH_RESULT_ALLOW;
-        }
-        else {
-            // Otherwise it's being cloned into the cloud. Block it
-            ret = ES_AUTH_RESULT_DENY;
-        }
-    }
-
-    // The app is not whitelisted and there is no restriction.
-    return ret;
-}
-
-uint32_t CloudProvider::AuthOpen(const std::string &bundleId, const std::vector<std::string> &cpPaths, const uint32_t fflags) const
-{
-    if (cpPaths.size() != 1)
-        throw "Open called with wrong paths!";
-
-    uint32_t ret = fflags;
-    if (BundleIdIsAllowed(bundleId))
-        return ret;
-
-    const std::string dropboxBundleId = "com.getdropbox.dropbox";
-    // If the operation is from/to one of Dropbox cache folders, allow it.
-    // !!!: we expect that the Dropbox cache folder is not accesible using Dropbox file explorer (which is true so far) so an user cannot do any mess there using the Dropbox app.
-    if (id == CloudProviderId::DROPBOX && bundleId == dropboxBundleId && ContainsDropboxCacheFolder(cpPaths))
-        return ret;
-
-    // If any restriction is set
-    if (bl != BlockLevel::NONE) {
-        uint32_t mask = ~0;
-
-        if (bl == BlockLevel::RONLY)
-            mask = ~(FWRITE | FAPPEND | O_CREAT);
-        else
-            mask = 0;
-
-        ret = fflags & mask;
-    }
-
-    return ret;
-}
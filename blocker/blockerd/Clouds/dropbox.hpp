@@ -16,13 +16,12 @@ struct Dropbox : public CloudProvider
         id = CloudProviderId::DROPBOX;
         bl = Bl;
         paths = Paths;
-        allowedBundleIds = {
-            //"com.getdropbox.dropbox",
-        };
+        allowedBundleIds = g_cpAllowedBundleIds.at(id);
     };
     ~Dropbox() = default;
 
-    static std::vector<std::string> FindPaths(const std::string &homePath);
+    /// @param rebaseOntoHome Folders from info.json of a copied home folder point to the original one, move them onto homePath
+    static std::vector<std::string> FindPaths(const std::string &homePath, const bool rebaseOntoHome = false);
 };
 
 #endif /* dropbox_hpp */
@@ -15,7 +15,7 @@
 
 static Logger &g_logger = Logger::getInstance();
 
-std::vector<std::string> Dropbox::FindPaths(const std::string &homePath)
+std::vector<std::string> Dropbox::FindPaths(const std::string &homePath, const bool rebaseOntoHome)
 {
     std::vector<std::string> paths;
 
@@ -46,7 +46,15 @@ std::vector<std::string> Dropbox::FindPaths(const std::string &homePath)
         }
 
         g_logger.log(LogLevel::VERBOSE, DEBUG_ARGS, "Dropbox: match[0] ", pathMatch[0], " match[1] ", pathMatch[1]);
-        paths.push_back(pathMatch[1]);
+        if (!rebaseOntoHome) {
+            paths.push_back(pathMatch[1]);
+            continue;
+        }
+
+        const std::string path = RebaseOntoHome(pathMatch[1], homePath);
+        if (path != pathMatch[1])
+            g_logger.log(LogLevel::INFO, DEBUG_ARGS, "Dropbox: \"", pathMatch[1], "\" rebased onto \"", path, "\".");
+        paths.push_back(path);
     }
     return paths;
 }
@@ -16,9 +16,7 @@ struct ICloud : public CloudProvider
         id = CloudProviderId::ICLOUD;
         bl = Bl;
         paths = Paths;
-        allowedBundleIds = {
-            "com.apple.bird",
-        };
+        allowedBundleIds = g_cpAllowedBundleIds.at(id);
     };
     ~ICloud() = default;
 
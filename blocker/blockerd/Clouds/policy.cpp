@@ -0,0 +1,225 @@
+//
+//  policy.cpp
+//  blockerd
+//
+//  Created by agent on 19/10/2026.
+//
+
+#include <algorithm>
+#include <fstream>
+#include <regex>
+
+#include "policy.hpp"
+
+
+const std::unordered_map<CloudProviderId, const std::string> g_cpToStr = {
+    {CloudProviderId::NONE,     "NONE"},
+    {CloudProviderId::ICLOUD,   "iCloud"},
+    {CloudProviderId::DROPBOX,  "Dropbox"},
+    {CloudProviderId::ONEDRIVE, "OneDrive"},
+};
+
+const std::unordered_map<CloudProviderId, const std::vector<std::string>> g_cpAllowedBundleIds = {
+    {CloudProviderId::ICLOUD,   {"com.apple.bird"}},
+    {CloudProviderId::DROPBOX,  {/*"com.getdropbox.dropbox",*/}},
+};
+
+CloudPolicy::CloudPolicy(CloudPolicy&& other)
+{
+    id = other.id;
+    bl = other.bl;
+    paths = std::move(other.paths);
+    allowedBundleIds = std::move(other.allowedBundleIds);
+
+    other.id = CloudProviderId::NONE;
+    other.bl = BlockLevel::NONE;
+    other.paths.clear();
+    other.allowedBundleIds.clear();
+}
+
+CloudPolicy& CloudPolicy::operator=(CloudPolicy&& other)
+{
+    if (this == &other)
+        return *this;
+
+    id = other.id;
+    bl = other.bl;
+    paths = std::move(other.paths);
+    allowedBundleIds = std::move(other.allowedBundleIds);
+
+    other.id = CloudProviderId::NONE;
+    other.bl = BlockLevel::NONE;
+    other.paths.clear();
+    other.allowedBundleIds.clear();
+
+    return *this;
+}
+
+bool CloudPolicy::BundleIdIsAllowed(const std::string &bundleId) const
+{
+    return (std::find(allowedBundleIds.begin(), allowedBundleIds.end(), bundleId) != allowedBundleIds.end());
+}
+
+std::vector<std::string> CloudPolicy::FilterCloudFolders(const std::vector<std::string> &eventPaths) const
+{
+    std::vector<std::string> ret;
+    for (const auto &eventPath : eventPaths) {
+        for (const auto &cpPath : paths) {
+            // Roots may overlap (e.g. ~/Dropbox and ~/Dropbox (Team)), report every event path just once.
+            if (eventPath.find(cpPath) != std::string::npos) {
+                ret.push_back(eventPath);
+                break;
+            }
+        }
+    }
+    return ret;
+}
+
+// MARK: Authorization
+/// Allows reading to everybody if in RONLY mode,
+/// otherwise blocks everything except whitelisted apps
+bool CloudPolicy::AuthReadGeneral(const std::string &bundleId) const
+{
+    // ALLOW the operation if not in FULL blocking mode
+    if (bl != BlockLevel::FULL)
+        return true;
+
+    // Otherwise block everything except whitelisted apps
+    return BundleIdIsAllowed(bundleId);
+}
+
+/// Blocks all operations except whitelisted apps, and
+/// allows  content modifying operations  by dropbox in dropbox cache folders.
+/// In RONLY mode copying data out of the cloud (e.g. CLONE with the source inside) is allowed.
+bool CloudPolicy::AuthWriteGeneral(const std::string &bundleId, const std::vector<std::string> &cpPaths, const bool copiesOutOfCloud) const
+{
+    if (BundleIdIsAllowed(bundleId))
+        return true;
+
+    // If the operation is from/to one of Dropbox folders, allow it.
+    if (IsDropboxCacheAccess(bundleId, cpPaths))
+        return true;
+
+    // In RONLY mode, if the destination is outside of the cloud we should not block it.
+    if (bl == BlockLevel::RONLY && copiesOutOfCloud)
+        return true;
+
+    // If there is any restriction block the operation.
+    return bl == BlockLevel::NONE;
+}
+
+uint32_t CloudPolicy::AuthOpen(const std::string &bundleId, const std::vector<std::string> &cpPaths, const uint32_t fflags) const
+{
+    if (cpPaths.size() != 1)
+        throw "Open called with wrong paths!";
+
+    uint32_t ret = fflags;
+    if (BundleIdIsAllowed(bundleId))
+        return ret;
+
+    // If the operation is from/to one of Dropbox cache folders, allow it.
+    if (IsDropboxCacheAccess(bundleId, cpPaths))
+        return ret;
+
+    // If any restriction is set
+    if (bl != BlockLevel::NONE) {
+        uint32_t mask = ~0;
+
+        if (bl == BlockLevel::RONLY)
+            mask = ~(FFLAG_WRITE | FFLAG_APPEND | FFLAG_CREAT);
+        else
+            mask = 0;
+
+        ret = fflags & mask;
+    }
+
+    return ret;
+}
+
+// MARK: - Protected
+/// Dropbox app working in its cache folders.
+/// !!!: we expect that the Dropbox cache folder is not accesible using Dropbox file explorer (which is true so far) so an user cannot do any mess there using the Dropbox app.
+bool CloudPolicy::IsDropboxCacheAccess(const std::string &bundleId, const std::vector<std::string> &cpPaths) const
+{
+    const std::string dropboxBundleId = "com.getdropbox.dropbox";
+    return id == CloudProviderId::DROPBOX && bundleId == dropboxBundleId && ContainsDropboxCacheFolder(cpPaths);
+}
+
+bool CloudPolicy::ContainsDropboxCacheFolder(const std::vector<std::string> &eventPaths) const
+{
+    for (const auto &dropboxPath : paths) {
+        const std::string dropboxCache = dropboxPath + "/.dropbox.cache";
+
+        for (const auto &eventPath : eventPaths)
+            if (eventPath.find(dropboxCache) != std::string::npos)
+                return true;
+    }
+    return false;
+}
+
+
+// MARK: - Cloud folders
+std::vector<std::string> FindCloudFolders(const CloudProviderId id, const std::string &homePath, std::string &error)
+{
+    switch (id) {
+        case CloudProviderId::ICLOUD:
+            return { homePath + "/Library/Mobile Documents" }; // $HOME/Library/Mobile Documents/com~apple~CloudDocs
+        case CloudProviderId::DROPBOX:
+            break;
+        default:
+            error = "Unsupported cloud provider.";
+            return {};
+    }
+
+    std::vector<std::string> paths;
+    const std::string configFile = homePath + "/.dropbox/info.json";
+    std::ifstream dropboxInfo(configFile);
+    if (!dropboxInfo.is_open()) {
+        error = "Could not open config file " + configFile;
+        return {};
+    }
+
+    const std::regex pathRegex("\"path\": \"(.*)\","); // TODO: If the path contains ", we are f...
+    std::smatch pathMatch;
+    std::string line;
+    while (std::getline(dropboxInfo, line))
+    {
+        if (!std::regex_search(line, pathMatch, pathRegex)) {
+            error = "Regex search failed.";
+            return {};
+        }
+
+        if (pathMatch.size() != 2) {
+            error = "No match found in path regex.";
+            return {};
+        }
+
+        paths.push_back(RebaseOntoHome(pathMatch[1], homePath));
+    }
+    return paths;
+}
+
+std::string RebaseOntoHome(const std::string &path, const std::string &homePath)
+{
+    const std::string usersDir = "/Users/";
+    const std::string sharedDir = "/Users/Shared";
+    std::string home = homePath;
+    while (home.size() > 1 && home.back() == '/')
+        home.pop_back();
+
+    const auto isUnder = [&path](const std::string &dir) {
+        return path.compare(0, dir.size(), dir) == 0 && (path.size() == dir.size() || path[dir.size()] == '/');
+    };
+
+    if (home.empty() || isUnder(home))
+        return path;
+    // Not a home folder of any user
+    if (path.compare(0, usersDir.size(), usersDir) != 0 || isUnder(sharedDir))
+        return path;
+
+    // Skip the user name, keep the rest including the leading '/'
+    const size_t restPos = path.find('/', usersDir.size());
+    if (restPos == std::string::npos)
+        return home;
+    return home + path.substr(restPos);
+}
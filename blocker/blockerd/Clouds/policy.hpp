@@ -0,0 +1,86 @@
+//
+//  policy.hpp
+//  blockerd
+//
+//  Created by agent on 19/10/2026.
+//
+
+#ifndef policy_hpp
+#define policy_hpp
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// This file must not depend on EndpointSecurity nor Foundation so the policy
+// can be evaluated outside of the ES handler (see scanner.hpp).
+
+enum class CloudProviderId : uint8_t
+{
+    NONE,
+    ICLOUD,
+    DROPBOX,
+    ONEDRIVE,
+    //Google Drive File Stream
+};
+
+enum class BlockLevel : uint8_t
+{
+    NONE,
+    RONLY,
+    FULL,
+};
+
+extern const std::unordered_map<CloudProviderId, const std::string> g_cpToStr;
+// Background processes needed for cloud synchronization
+extern const std::unordered_map<CloudProviderId, const std::vector<std::string>> g_cpAllowedBundleIds;
+
+// Kernel fflags as delivered in es_event_open_t (XNU <sys/fcntl.h> values).
+enum FFlag : uint32_t
+{
+    FFLAG_READ   = 0x00000001,  // FREAD
+    FFLAG_WRITE  = 0x00000002,  // FWRITE
+    FFLAG_APPEND = 0x00000008,  // FAPPEND
+    FFLAG_CREAT  = 0x00000200,  // O_CREAT
+};
+
+struct CloudPolicy
+{
+    CloudProviderId id = CloudProviderId::NONE;
+    BlockLevel bl = BlockLevel::NONE;
+    std::vector<std::string> paths;
+    std::vector<std::string> allowedBundleIds;
+
+    CloudPolicy() = default;
+    virtual ~CloudPolicy() = default;
+    // delete copy operations
+    CloudPolicy(const CloudPolicy &) = delete;
+    void operator=(const CloudPolicy &) = delete;
+    // move operations
+    CloudPolicy(CloudPolicy&& other);
+    CloudPolicy& operator=(CloudPolicy&& other);
+
+    bool BundleIdIsAllowed(const std::string &bundleId) const;
+    std::vector<std::string> FilterCloudFolders(const std::vector<std::string> &eventPaths) const;
+
+    // Authorization decisions
+    bool     AuthReadGeneral(const std::string &bundleId) const;
+    bool     AuthWriteGeneral(const std::string &bundleId, const std::vector<std::string> &cpPaths, const bool copiesOutOfCloud = false) const;
+    uint32_t AuthOpen(const std::string &bundleId, const std::vector<std::string> &cpPaths, const uint32_t fflags) const;
+
+protected:
+    bool IsDropboxCacheAccess(const std::string &bundleId, const std::vector<std::string> &cpPaths) const;
+    bool ContainsDropboxCacheFolder(const std::vector<std::string> &eventPaths) const;
+};
+
+/// Finds cloud folders of the provider in an explicitly given (e.g. copied) home folder,
+/// Dropbox folders are rebased onto it. Same as ICloud::FindPaths() and Dropbox::FindPaths(homePath, true).
+/// @return Nothing if they could not be found, the reason is stored in error
+std::vector<std::string> FindCloudFolders(const CloudProviderId id, const std::string &homePath, std::string &error);
+/// Moves a cloud folder of the original home folder (/Users/<name>/...) onto homePath.
+/// Configuration files in a copy of a home folder still refer to the original location.
+/// Never use it for the active user's home folder, folders of other users would be moved onto it.
+std::string RebaseOntoHome(const std::string &path, const std::string &homePath);
+
+#endif /* policy_hpp */
@@ -9,6 +9,7 @@
 #define blocker_hpp
 
 #include <any>
+#include <atomic>
 #include <cstdint>
 #include <EndpointSecurity/EndpointSecurity.h>
 #include <functional>
@@ -18,6 +19,9 @@
 #include <vector>
 
 #include "Clouds/base.hpp"
+#include "negativecache.hpp"
+#include "scanner.hpp"
+#include "shadowpool.hpp"
 #include "cloudblocker.hpp"
 #include "diskblocker.hpp"
 
@@ -41,7 +45,9 @@ public:
     static Blocker& GetInstance();
     bool Init();
     void Uninit();
-    bool Configure(const std::unordered_map<CloudProviderId, BlockLevel> &config);
+    bool Configure(const std::unordered_map<CloudProviderId, BlockLevel> &config, const std::string &homePath = "", const bool rebaseOntoHome = false);
+    bool ConfigureShadow(const std::unordered_map<CloudProviderId, BlockLevel> &config, const unsigned int sampleRate, const std::string &homePath = "");
+    void DryRunScan(const std::string &root, const DryRunScanner::Options &opts);
 
     // MARK: Logging
     void PrintStats();
@@ -52,9 +52,9 @@ void Blocker::Uninit()
     diskBlocker.Uninit();
 }
 
-bool Blocker::Configure(const std::unordered_map<CloudProviderId, BlockLevel> &config)
+bool Blocker::Configure(const std::unordered_map<CloudProviderId, BlockLevel> &config, const std::string &homePath, const bool rebaseOntoHome)
 {
-    if (!cloudBlocker.Configure(config)) {
+    if (!cloudBlocker.Configure(config, homePath, rebaseOntoHome)) {
         g_logger.log(LogLevel::ERR, DEBUG_ARGS, "CloudBlocker config failed.");
         return false;
     }
@@ -62,6 +62,21 @@ bool Blocker::Configure(const std::unordered_map<CloudProviderId, BlockLevel> &c
     return true;
 }
 
+bool Blocker::ConfigureShadow(const std::unordered_map<CloudProviderId, BlockLevel> &config, const unsigned int sampleRate, const std::string &homePath)
+{
+    if (!cloudBlocker.ConfigureShadow(config, sampleRate, homePath)) {
+        g_logger.log(LogLevel::ERR, DEBUG_ARGS, "CloudBlocker shadow config failed.");
+        return false;
+    }
+
+    return true;
+}
+
+void Blocker::DryRunScan(const std::string &root, const DryRunScanner::Options &opts)
+{
+    cloudBlocker.DryRunScan(root, opts);
+}
+
 
 void Blocker::PrintStats()
 {
@@ -26,12 +26,44 @@ class CloudBlocker
             uint64_t droppedDeadline = 0;
         };
 
+        struct NegativeCacheStats {
+            std::atomic<uint64_t> hits           {0};
+            std::atomic<uint64_t> misses         {0};
+            std::atomic<uint64_t> inserts        {0};  // new entries only
+            std::atomic<uint64_t> evictions      {0};
+            std::atomic<uint64_t> invalidations  {0};  // single entries erased
+            std::atomic<uint64_t> flushes        {0};  // whole cache cleared
+            std::atomic<uint64_t> savedPathBytes {0};  // path bytes neither copied nor matched
+        };
+
+        struct ShadowStats {
+            std::atomic<bool> enabled {false};  // published once the shadow pool runs
+            std::atomic<uint64_t> seenEvents    {0};
+            std::atomic<uint64_t> sampledEvents {0};
+            std::atomic<uint64_t> droppedEvents {0};
+            uint64_t evaluatedEvents = 0;
+            uint64_t allowedEvents   = 0;
+            uint64_t blockedEvents   = 0;
+            std::unordered_map<std::string, uint64_t> blockedPerApp;
+            // Comparison with the enforced verdicts (only if both configurations are set)
+            uint64_t bothAllowed         = 0;
+            uint64_t bothBlocked         = 0;
+            uint64_t onlyShadowBlocked   = 0;
+            uint64_t onlyEnforcedBlocked = 0;
+            NegativeCacheStats negativeCache;   // of m_shadowOutsideCache
+        };
+
         std::unordered_map<es_event_type_t, EventStats> eventStats;
         uint64_t blockedEvents = 0;
         uint64_t allowedEvents = 0;
         uint64_t respondErrors = 0;
+        ShadowStats shadow;
+        NegativeCacheStats negativeCache;   // of m_outsideCache
     };
 
+    static constexpr unsigned int SHADOW_THREADS = 2;
+    static constexpr size_t SHADOW_QUEUE_CAPACITY = 4096;
+
     const std::vector<es_event_type_t> m_eventsOfInterest = {
         // File System
         ES_EVENT_TYPE_AUTH_CLONE,
@@ -52,29 +84,59 @@ class CloudBlocker
         ES_EVENT_TYPE_NOTIFY_EXCHANGEDATA,
         ES_EVENT_TYPE_NOTIFY_UNMOUNT,
         ES_EVENT_TYPE_NOTIFY_WRITE,
+        // Only to keep the negative cache coherent
+        ES_EVENT_TYPE_NOTIFY_LINK,
+        ES_EVENT_TYPE_NOTIFY_MOUNT,
+        ES_EVENT_TYPE_NOTIFY_RENAME,
+        ES_EVENT_TYPE_NOTIFY_UNLINK,
     };
 
     es_client_t *m_clt = nullptr;
     Stats m_stats;
     std::mutex m_statsMtx;
     std::unordered_map<CloudProviderId, CloudProvider> m_config;
+    std::unordered_map<CloudProviderId, CloudProvider> m_shadowConfig;
     std::mutex m_configMtx;
-
-    std::vector<CloudInstance> ResolveCloudProvider(const std::vector<std::string> &eventPaths) const;
+    // Respond immediately and only evaluate the shadow configuration
+    std::atomic<bool> m_observeOnly {false};
+    std::atomic<unsigned int> m_shadowSampleRate {100};
+    ShadowPool m_shadowPool;
+    // Files outside of all cloud folders of m_config and m_shadowConfig respectively
+    NegativeCache::ShardGenerations m_cacheGenerations {};
+    NegativeCache m_outsideCache {m_cacheGenerations};
+    NegativeCache m_shadowOutsideCache {m_cacheGenerations};
+
+    static bool ResolveHomePath(std::string &homePath);
+    static void LoadConfig(const std::unordered_map<CloudProviderId, BlockLevel> &config, const std::string &homePath, const bool rebaseOntoHome,
+                           std::unordered_map<CloudProviderId, CloudProvider> &dst);
+    static std::vector<CloudInstance> ResolveCloudProvider(const std::unordered_map<CloudProviderId, CloudProvider> &config,
+                                                           const std::vector<std::string> &eventPaths);
+
+    void UpdateObserveOnly();
 
     void AuthorizeESEvent(es_client_t * const clt, const es_message_t * const msg, const std::any &result);
     bool IsAllowingResult(const std::any &result, const es_message_t * const msg);
 
-    std::any HandleEventImpl(const es_message_t * const msg);
+    std::any HandleEventImpl(const es_message_t * const msg, const NegativeCache::Generation &cacheGeneration);
+    std::any EvaluateEvent(const std::unordered_map<CloudProviderId, CloudProvider> &config, NegativeCache &outsideCache,
+                           Stats::NegativeCacheStats &cacheStats, const es_message_t * const msg, const NegativeCache::Generation &cacheGeneration);
+    void EnqueueShadowEvent(const es_message_t * const msg, const std::any &enforced, const NegativeCache::Generation &cacheGeneration);
+
+    bool InvalidateNegativeCache(const es_message_t * const msg);
+    void InvalidateNegativeCache(const es_file_t * const file);
+    void ClearNegativeCache();
 
     void IncreaseStats(const CloudBlockerStats metric, const es_event_type_t type, const uint64_t count = 1);
 
 
     // MARK: Callbacks
-    void HandleEvent(es_client_t * const clt, const es_message_t * const msg);
+    void HandleEvent(es_client_t * const clt, const es_message_t * const msg, const NegativeCache::Generation &cacheGeneration);
+    void HandleShadowEvent(const es_message_t * const msg, const std::any &enforced, const NegativeCache::Generation &cacheGeneration);
 
     // MARK: Logging
     friend std::ostream & operator << (std::ostream &out, const CloudBlocker::Stats &stats);
+    friend std::ostream & operator << (std::ostream &out, const CloudBlocker::Stats::ShadowStats &stats);
+    friend std::ostream & operator << (std::ostream &out, const CloudBlocker::Stats::NegativeCacheStats &stats);
 
 public:
     CloudBlocker() = default;
@@ -86,7 +148,9 @@ public:
     static CloudBlocker& GetInstance();
     bool Init();
     void Uninit();
-    bool Configure(const std::unordered_map<CloudProviderId, BlockLevel> &config);
+    bool Configure(const std::unordered_map<CloudProviderId, BlockLevel> &config, std::string homePath = "", const bool rebaseOntoHome = false);
+    bool ConfigureShadow(const std::unordered_map<CloudProviderId, BlockLevel> &config, const unsigned int sampleRate, std::string homePath = "");
+    void DryRunScan(const std::string &root, const DryRunScanner::Options &opts);
     void PrintStats();
 };
 
@@ -5,6 +5,7 @@
 //  Created by Jozef on 05/06/2020.
 //
 
+#include <algorithm>
 #include <any>
 #include <EndpointSecurity/EndpointSecurity.h>
 #include <future>
@@ -12,6 +13,7 @@
 #include <paths.h>      // _PATH_CONSOLE
 #include <pwd.h>        // getpwuid()
 #include <sys/fcntl.h>  // FREAD, FWRITE
+#include <sys/stat.h>   // S_ISDIR()
 #import <Foundation/Foundation.h>
 
 #include "../../Common/logger.hpp"
@@ -20,6 +22,9 @@
 #include "Clouds/base.hpp"
 #include "Clouds/dropbox.hpp"
 #include "Clouds/icloud.hpp"
+#include "negativecache.hpp"
+#include "scanner.hpp"
+#include "shadowpool.hpp"
 #include "cloudblocker.hpp"
 
 // From <Kernel/sys/fcntl.h>
@@ -36,6 +41,22 @@ static Logger &g_logger = Logger::getInstance();
 bool CloudBlocker::Init()
 {
     es_handler_block_t handler = ^(es_client_t *clt, const es_message_t *msg) {
+        // Evaluation is asynchronous, its results must not be cached if anything was invalidated since now.
+        const NegativeCache::Generation cacheGeneration = m_outsideCache.CurrentGeneration();
+
+        // Events we are subscribed to only because of the negative cache
+        if (InvalidateNegativeCache(msg))
+            return;
+
+        // Observe-only mode. Respond right away and evaluate the policy off the critical path.
+        if (m_observeOnly) {
+            if (msg->action_type == ES_ACTION_TYPE_AUTH) {
+                AuthorizeESEvent(clt, msg, getDefaultESResponse(msg));
+                EnqueueShadowEvent(msg, std::any(), cacheGeneration);
+            }
+            return;
+        }
+
         es_message_t *msgCopy = es_copy_message(msg);
         if (msgCopy == nullptr) {
             g_logger.log(LogLevel::ERR, DEBUG_ARGS, "Could not copy message.");
@@ -45,7 +66,7 @@ bool CloudBlocker::Init()
         }
 
         dispatch_async(dispatch_get_main_queue(), ^{
-            CloudBlocker::GetInstance().HandleEvent(clt, msgCopy);
+            CloudBlocker::GetInstance().HandleEvent(clt, msgCopy, cacheGeneration);
             es_free_message(msgCopy);
         });
     };
@@ -105,52 +126,107 @@ void CloudBlocker::Uninit()
         es_delete_client(m_clt);
         m_clt = nullptr;
     }
+    m_shadowPool.Stop();
 }
 
-bool CloudBlocker::Configure(const std::unordered_map<CloudProviderId, BlockLevel> &config)
+bool CloudBlocker::Configure(const std::unordered_map<CloudProviderId, BlockLevel> &config, std::string homePath, const bool rebaseOntoHome)
 {
     std::scoped_lock<std::mutex> lock(m_configMtx);
 
-    struct stat info;
-    if (lstat(_PATH_CONSOLE, &info)) {
-        g_logger.log(LogLevel::ERR, DEBUG_ARGS, "Could not get the active user");
+    if (!ResolveHomePath(homePath))
         return false;
-    }
 
-    const struct passwd * const pwd = getpwuid(info.st_uid);
-    if (pwd == nullptr)  {
-        g_logger.log(LogLevel::ERR, DEBUG_ARGS, "Could not get user information from UID");
+    LoadConfig(config, homePath, rebaseOntoHome, m_config);
+    ClearNegativeCache();
+    if (m_stats.shadow.enabled)
+        UpdateObserveOnly();
+    return true;
+}
+
+bool CloudBlocker::ConfigureShadow(const std::unordered_map<CloudProviderId, BlockLevel> &config, const unsigned int sampleRate, std::string homePath)
+{
+    std::scoped_lock<std::mutex> lock(m_configMtx);
+
+    if (sampleRate == 0 || sampleRate > 100) {
+        g_logger.log(LogLevel::ERR, DEBUG_ARGS, "Invalid shadow sample rate (", sampleRate, ").");
         return false;
     }
-    const std::string homePath = "/Users/" + std::string(pwd->pw_name);
 
-    std::vector<std::string> paths;
-    for (const auto &[cpId, blkLvl] : config) {
-        switch (cpId) {
-            case CloudProviderId::ICLOUD:
-            {
-                paths = ICloud::FindPaths(homePath);
-                m_config[cpId] = ICloud(blkLvl, paths);
-                break;
-            }
-            case CloudProviderId::DROPBOX:
-            {
-                paths = Dropbox::FindPaths(homePath);
-                m_config[cpId] = Dropbox(blkLvl, paths);
-                break;
-            }
-            default:
-                break;
-        }
+    if (!ResolveHomePath(homePath))
+        return false;
 
-        if (paths.empty())
-            g_logger.log(LogLevel::ERR, DEBUG_ARGS, "Could not set ", g_cpToStr.at(cpId), " paths.");
-        for (const auto &path : paths)
-            g_logger.log(LogLevel::INFO, DEBUG_ARGS, g_cpToStr.at(cpId), ": Path set to \"", path, "\".");
-    }
+    LoadConfig(config, homePath, false, m_shadowConfig);
+    ClearNegativeCache();
+    for (auto &[cpId, cp] : m_shadowConfig)
+        cp.shadow = true;
+
+    m_shadowSampleRate = sampleRate;
+
+    const bool started = m_shadowPool.Start(SHADOW_THREADS, SHADOW_QUEUE_CAPACITY,
+                                            [this](const es_message_t * const msg, const std::any &enforced, const NegativeCache::Generation &cacheGeneration) {
+        HandleShadowEvent(msg, enforced, cacheGeneration);
+    });
+    if (!started)
+        return false;
+
+    // Events are already flowing, do not let them in before the pool can take them
+    m_stats.shadow.enabled = true;
+    UpdateObserveOnly();
     return true;
 }
 
+void CloudBlocker::DryRunScan(const std::string &root, const DryRunScanner::Options &opts)
+{
+    std::scoped_lock<std::mutex> lock(m_configMtx);
+
+    std::vector<std::reference_wrapper<const CloudPolicy>> policies;
+    for (const auto &[cpId,cp] : m_config)
+        policies.push_back(cp);
+
+    DryRunScanner scanner(policies, opts);
+    std::cout << scanner.Scan(root) << std::endl;
+}
+
+std::ostream & operator << (std::ostream &out, const CloudBlocker::Stats::NegativeCacheStats &stats)
+{
+    const uint64_t lookups = stats.hits + stats.misses;
+
+    out << std::endl << "Hits: " << stats.hits;
+    out << std::endl << "Misses: " << stats.misses;
+    out << std::endl << "Hit Rate: " << (lookups == 0 ? 0 : stats.hits * 100 / lookups) << " %";
+    out << std::endl << "Saved Path Bytes: " << stats.savedPathBytes;
+    out << std::endl << "Inserts: " << stats.inserts;
+    out << std::endl << "Evictions: " << stats.evictions;
+    out << std::endl << "Invalidations: " << stats.invalidations;
+    out << std::endl << "Flushes: " << stats.flushes;
+    return out;
+}
+
+std::ostream & operator << (std::ostream &out, const CloudBlocker::Stats::ShadowStats &stats)
+{
+    out << std::endl << " -- Shadow:";
+    out << std::endl << "Seen Events: " << stats.seenEvents;
+    out << std::endl << "Sampled Events: " << stats.sampledEvents;
+    out << std::endl << "Dropped Events: " << stats.droppedEvents;
+    out << std::endl << "Evaluated Events: " << stats.evaluatedEvents;
+    out << std::endl << "Would Allow: " << stats.allowedEvents;
+    out << std::endl << "Would Block: " << stats.blockedEvents;
+    for (const auto &[bundleId,count] : stats.blockedPerApp)
+        out << std::endl << "    " << bundleId << ": " << count;
+    out << std::endl << " -- Shadow Negative Cache:" << stats.negativeCache;
+
+    const uint64_t compared = stats.bothAllowed + stats.bothBlocked + stats.onlyShadowBlocked + stats.onlyEnforcedBlocked;
+    if (compared == 0)
+        return out;
+
+    out << std::endl << " -- Shadow vs Enforced:";
+    out << std::endl << "Both Allowed: " << stats.bothAllowed;
+    out << std::endl << "Both Blocked: " << stats.bothBlocked;
+    out << std::endl << "Only Shadow Blocked: " << stats.onlyShadowBlocked;
+    out << std::endl << "Only Enforced Blocked: " << stats.onlyEnforcedBlocked;
+    return out;
+}
+
 std::ostream & operator << (std::ostream &out, const CloudBlocker::Stats &stats)
 {
     uint64_t copyErrorsSum = 0;
@@ -175,6 +251,9 @@ std::ostream & operator << (std::ostream &out, const CloudBlocker::Stats &stats)
     out << std::endl << "Allowed Events: " << stats.allowedEvents;
     out << std::endl << "Blocked Events: " << stats.blockedEvents;
     out << std::endl << "Respond Errors: " << stats.respondErrors;
+    out << std::endl << " -- Negative Cache:" << stats.negativeCache;
+    if (stats.shadow.enabled)
+        out << stats.shadow;
     return out;
 }
 
@@ -197,12 +276,78 @@ void CloudBlocker::IncreaseStats(const CloudBlockerStats metric, const es_event_
     }
 }
 
-std::vector<CloudInstance> CloudBlocker::ResolveCloudProvider(const std::vector<std::string> &eventPaths) const
+bool CloudBlocker::ResolveHomePath(std::string &homePath)
+{
+    // Use the home folder of the active user if not set explicitly
+    if (!homePath.empty()) {
+        // Cloud folders are composed as homePath + "/..."
+        while (homePath.size() > 1 && homePath.back() == '/')
+            homePath.pop_back();
+        return true;
+    }
+
+    struct stat info;
+    if (lstat(_PATH_CONSOLE, &info)) {
+        g_logger.log(LogLevel::ERR, DEBUG_ARGS, "Could not get the active user");
+        return false;
+    }
+
+    const struct passwd * const pwd = getpwuid(info.st_uid);
+    if (pwd == nullptr)  {
+        g_logger.log(LogLevel::ERR, DEBUG_ARGS, "Could not get user information from UID");
+        return false;
+    }
+    homePath = "/Users/" + std::string(pwd->pw_name);
+    return true;
+}
+
+void CloudBlocker::LoadConfig(const std::unordered_map<CloudProviderId, BlockLevel> &config, const std::string &homePath, const bool rebaseOntoHome,
+                              std::unordered_map<CloudProviderId, CloudProvider> &dst)
+{
+    std::vector<std::string> paths;
+    for (const auto &[cpId, blkLvl] : config) {
+        switch (cpId) {
+            case CloudProviderId::ICLOUD:
+            {
+                paths = ICloud::FindPaths(homePath);
+                dst[cpId] = ICloud(blkLvl, paths);
+                break;
+            }
+            case CloudProviderId::DROPBOX:
+            {
+                paths = Dropbox::FindPaths(homePath, rebaseOntoHome);
+                dst[cpId] = Dropbox(blkLvl, paths);
+                break;
+            }
+            default:
+                break;
+        }
+
+        if (paths.empty())
+            g_logger.log(LogLevel::ERR, DEBUG_ARGS, "Could not set ", g_cpToStr.at(cpId), " paths.");
+        for (const auto &path : paths)
+            g_logger.log(LogLevel::INFO, DEBUG_ARGS, g_cpToStr.at(cpId), ": Path set to \"", path, "\".");
+    }
+}
+
+/// Call with m_configMtx locked
+void CloudBlocker::UpdateObserveOnly()
+{
+    // Nothing is enforced, do not keep the kernel waiting.
+    const bool observeOnly = std::none_of(m_config.begin(), m_config.end(),
+                                          [](const auto &cp) { return cp.second.bl != BlockLevel::NONE; });
+    if (observeOnly && !m_observeOnly)
+        g_logger.log(LogLevel::INFO, DEBUG_ARGS, "Running in observe-only (shadow) mode.");
+    m_observeOnly = observeOnly;
+}
+
+std::vector<CloudInstance> CloudBlocker::ResolveCloudProvider(const std::unordered_map<CloudProviderId, CloudProvider> &config,
+                                                              const std::vector<std::string> &eventPaths)
 {
     // TODO: make it more effective
     std::vector<CloudInstance> ret;
     // For every cloud provider
-    for (const auto &[cpId,cp] : m_config) {
+    for (const auto &[cpId,cp] : config) {
         std::vector<std::string> tmp = cp.FilterCloudFolders(eventPaths);
         if (!tmp.empty())
             ret.push_back({cp, tmp});
@@ -251,7 +396,7 @@ bool CloudBlocker::IsAllowingResult(const std::any &result, const es_message_t *
     }
 }
 
-std::any CloudBlocker::HandleEventImpl(const es_message_t * const msg)
+std::any CloudBlocker::HandleEventImpl(const es_message_t * const msg, const NegativeCache::Generation &cacheGeneration)
 {
     if (msg == nullptr) {
         g_logger.log(LogLevel::ERR, DEBUG_ARGS, "Got nullptr!");
@@ -277,13 +422,52 @@ std::any CloudBlocker::HandleEventImpl(const es_message_t * const msg)
     // set the new lastSeq
     eventStats.lastSeqNum = msg->seq_num;
 
+    return EvaluateEvent(m_config, m_outsideCache, m_stats.negativeCache, msg, cacheGeneration);
+}
+
+std::any CloudBlocker::EvaluateEvent(const std::unordered_map<CloudProviderId, CloudProvider> &config, NegativeCache &outsideCache,
+                                     Stats::NegativeCacheStats &cacheStats, const es_message_t * const msg, const NegativeCache::Generation &cacheGeneration)
+{
+    std::any ret = getDefaultESResponse(msg);
+
+    // If all the event files are known to be outside of the clouds, skip the path matching completely.
+    const std::vector<const es_file_t *> eventFiles = files_from_event(msg);
+    if (!eventFiles.empty()) {
+        uint64_t pathBytes = 0;
+        bool allOutside = true;
+        for (const es_file_t * const file : eventFiles) {
+            if (!outsideCache.Contains(file->stat.st_dev, file->stat.st_ino)) {
+                allOutside = false;
+                break;
+            }
+            pathBytes += file->path.length;
+        }
+
+        if (allOutside) {
+            cacheStats.hits++;
+            cacheStats.savedPathBytes += pathBytes;
+            return ret;
+        }
+        cacheStats.misses++;
+    }
+
     // !!!: This call WILL crash if called with unsupported event type
     std::vector<std::string> eventPaths = paths_from_event(msg);
 
-    const auto cpPaths = ResolveCloudProvider(eventPaths);
+    const auto cpPaths = ResolveCloudProvider(config, eventPaths);
     // Not a supported cloud provider, ignore the event.
-    if (cpPaths.empty())
+    if (cpPaths.empty()) {
+        for (const es_file_t * const file : eventFiles) {
+            // A file with more hard links may be accessible also from a cloud folder
+            if (file->path_truncated || (!S_ISDIR(file->stat.st_mode) && file->stat.st_nlink != 1))
+                continue;
+            size_t evicted = 0;
+            if (outsideCache.Insert(file->stat.st_dev, file->stat.st_ino, cacheGeneration, evicted))
+                cacheStats.inserts++;
+            cacheStats.evictions += evicted;
+        }
         return ret;
+    }
 
     // In case it's a rename operation from one cloud to the other one,
     // ask both cloud providers if the operation is allowed.
@@ -298,9 +482,11 @@ std::any CloudBlocker::HandleEventImpl(const es_message_t * const msg)
 }
 
 // MARK: Callbacks
-void CloudBlocker::HandleEvent(es_client_t * const clt, const es_message_t * const msg)
+void CloudBlocker::HandleEvent(es_client_t * const clt, const es_message_t * const msg, const NegativeCache::Generation &cacheGeneration)
 {
     std::any result = getDefaultESResponse(msg);
+    // False if the default response is used because the evaluation failed
+    bool evaluated = false;
 
     try {
         if (msg == nullptr) {
@@ -312,7 +498,7 @@ void CloudBlocker::HandleEvent(es_client_t * const clt, const es_message_t * con
         // Set deadline a bit sooner
         const std::chrono::milliseconds f_msecDeadline { msecDeadline - (msecDeadline >> 3) }; // substract 12.5%
 
-        std::future<std::any> f = std::async(std::launch::async, &CloudBlocker::HandleEventImpl, this, msg);
+        std::future<std::any> f = std::async(std::launch::async, &CloudBlocker::HandleEventImpl, this, msg, cacheGeneration);
         const std::future_status f_res = f.wait_until(std::chrono::steady_clock::now() + f_msecDeadline);
 
         // If it's an NOTIFY event, we do not need to do anything. Just return.
@@ -330,8 +516,10 @@ void CloudBlocker::HandleEvent(es_client_t * const clt, const es_message_t * con
 
             if (!resultTmp.has_value())
                 g_logger.log(LogLevel::ERR, DEBUG_ARGS, "HandleEventImpl did not return a value!!");
-            else
+            else {
                 result = resultTmp;
+                evaluated = true;
+            }
         }
     } catch (const std::exception &e) {
         g_logger.log(LogLevel::ERR, DEBUG_ARGS, e.what());
@@ -341,6 +529,122 @@ void CloudBlocker::HandleEvent(es_client_t * const clt, const es_message_t * con
     }
 
     AuthorizeESEvent(clt, msg, result);
+
+    if (m_stats.shadow.enabled && msg->action_type == ES_ACTION_TYPE_AUTH)
+        EnqueueShadowEvent(msg, (evaluated ? result : std::any()), cacheGeneration);
+}
+
+/// Drops cached files which could have been moved under a cloud folder (or whose inode could be reused).
+/// @return True if we are subscribed to the event only because of the cache and it needs no further handling.
+bool CloudBlocker::InvalidateNegativeCache(const es_message_t * const msg)
+{
+    switch (msg->event_type) {
+        case ES_EVENT_TYPE_AUTH_RENAME:
+        case ES_EVENT_TYPE_NOTIFY_RENAME:
+        {
+            const es_event_rename_t &event = msg->event.rename;
+            // The whole subtree is moved, we do not know what was cached from it.
+            if (S_ISDIR(event.source->stat.st_mode)) {
+                ClearNegativeCache();
+            } else {
+                InvalidateNegativeCache(event.source);
+                if (event.destination_type == ES_DESTINATION_TYPE_EXISTING_FILE)
+                    InvalidateNegativeCache(event.destination.existing_file);
+            }
+            break;
+        }
+        case ES_EVENT_TYPE_AUTH_LINK:
+        case ES_EVENT_TYPE_NOTIFY_LINK:
+            InvalidateNegativeCache(msg->event.link.source);
+            break;
+        case ES_EVENT_TYPE_AUTH_UNLINK:
+        case ES_EVENT_TYPE_NOTIFY_UNLINK:
+            InvalidateNegativeCache(msg->event.unlink.target);
+            break;
+        case ES_EVENT_TYPE_NOTIFY_EXCHANGEDATA:
+            InvalidateNegativeCache(msg->event.exchangedata.file1);
+            InvalidateNegativeCache(msg->event.exchangedata.file2);
+            break;
+        // Device numbers change and directories may be covered by a new file system.
+        case ES_EVENT_TYPE_AUTH_MOUNT:
+        case ES_EVENT_TYPE_NOTIFY_MOUNT:
+        case ES_EVENT_TYPE_NOTIFY_UNMOUNT:
+            ClearNegativeCache();
+            break;
+        default:
+            break;
+    }
+
+    // NOTIFY events are delivered after the operation. Events which arrived before it
+    // are evaluated with an older cache generation so they cannot cache anything stale.
+    return (msg->event_type == ES_EVENT_TYPE_NOTIFY_LINK
+            || msg->event_type == ES_EVENT_TYPE_NOTIFY_MOUNT
+            || msg->event_type == ES_EVENT_TYPE_NOTIFY_RENAME
+            || msg->event_type == ES_EVENT_TYPE_NOTIFY_UNLINK);
+}
+
+void CloudBlocker::InvalidateNegativeCache(const es_file_t * const file)
+{
+    if (m_outsideCache.Erase(file->stat.st_dev, file->stat.st_ino))
+        m_stats.negativeCache.invalidations++;
+    if (m_shadowOutsideCache.Erase(file->stat.st_dev, file->stat.st_ino))
+        m_stats.shadow.negativeCache.invalidations++;
+}
+
+void CloudBlocker::ClearNegativeCache()
+{
+    m_outsideCache.Clear();
+    m_shadowOutsideCache.Clear();
+    m_stats.negativeCache.flushes++;
+    m_stats.shadow.negativeCache.flushes++;
+}
+
+void CloudBlocker::EnqueueShadowEvent(const es_message_t * const msg, const std::any &enforced, const NegativeCache::Generation &cacheGeneration)
+{
+    // Evenly spread sampling, e.g. every 4th event for 25 %
+    const uint64_t n = m_stats.shadow.seenEvents++;
+    const unsigned int rate = m_shadowSampleRate;
+    if ((n + 1) * rate / 100 == n * rate / 100)
+        return;
+
+    m_stats.shadow.sampledEvents++;
+    if (!m_shadowPool.Push(msg, enforced, cacheGeneration))
+        m_stats.shadow.droppedEvents++;
+}
+
+void CloudBlocker::HandleShadowEvent(const es_message_t * const msg, const std::any &enforced, const NegativeCache::Generation &cacheGeneration)
+{
+    const std::any result = EvaluateEvent(m_shadowConfig, m_shadowOutsideCache, m_stats.shadow.negativeCache, msg, cacheGeneration);
+    if (!result.has_value()) {
+        g_logger.log(LogLevel::ERR, DEBUG_ARGS, "EvaluateEvent did not return a value!!");
+        return;
+    }
+
+    const bool allowed = IsAllowingResult(result, msg);
+    const std::string bundleId = to_string(msg->process->signing_id);
+
+    std::scoped_lock<std::mutex> lock(m_statsMtx);
+    Stats::ShadowStats &stats = m_stats.shadow;
+    stats.evaluatedEvents++;
+    if (allowed) {
+        stats.allowedEvents++;
+    } else {
+        stats.blockedEvents++;
+        stats.blockedPerApp[bundleId]++;
+    }
+
+    if (!enforced.has_value())
+        return;
+
+    const bool enforcedAllowed = IsAllowingResult(enforced, msg);
+    if (allowed && enforcedAllowed)
+        stats.bothAllowed++;
+    else if (!allowed && !enforcedAllowed)
+        stats.bothBlocked++;
+    else if (!allowed)
+        stats.onlyShadowBlocked++;
+    else
+        stats.onlyEnforcedBlocked++;
 }
 
 void CloudBlocker::PrintStats()
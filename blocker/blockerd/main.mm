@@ -9,10 +9,12 @@
 #include <getopt.h>
 #include <iostream>
 #include <signal.h>
+#include <stdexcept>
 #include <unordered_map>
 #import <Foundation/Foundation.h>
 
 #include "blocker.hpp"
+#include "scanner.hpp"
 #include "../../Common/logger.hpp"
 #include "../../Common/SignalHandler.hpp"
 
@@ -20,6 +22,8 @@
 void printHelp()
 {
     std::cout << "Usage: blockerd  [<cloud_provider> <block_level>] [-v <0-4>] [-h]" << std::endl;
+    std::cout << "       blockerd  [<cloud_provider> <block_level>] [<shadow_cloud_provider> <block_level>] [-r <rate>]" << std::endl;
+    std::cout << "       blockerd  [<cloud_provider> <block_level>] -s <root> [-b <bundle_id>] [-o <operations>] [-H <home>] [-j <threads>]" << std::endl;
     std::cout << "    -v, --verbosity   Verbosity level [0-4]. Default is 3."        << std::endl;
     std::cout << "    -h, --help        Print usage."                                << std::endl;
     std::cout << "Supported Cloud Providers:"                                        << std::endl;
@@ -29,21 +33,77 @@ void printHelp()
     std::cout << "    none              No blocking (DEFAULT)"                       << std::endl;
     std::cout << "    ronly             Read-only mode"                              << std::endl;
     std::cout << "    full              Full blocking mode"                          << std::endl;
+    std::cout << "Dry-run scan (evaluates the policy over a directory tree, nothing is blocked):" << std::endl;
+    std::cout << "    -s, --dry-run-scan <root>   Directory tree to be scanned"          << std::endl;
+    std::cout << "    -b, --bundle-id <id>        Application to be evaluated (repeatable). Default is any non-whitelisted app." << std::endl;
+    std::cout << "    -o, --operations <list>     Comma separated list of read,write,copy-out,open-r,open-w. Default is all." << std::endl;
+    std::cout << "    -H, --home <path>           Home folder used to find cloud folders. Default is the active user's one." << std::endl;
+    std::cout << "    -j, --threads <1-256>       Number of scanning threads. Default is the number of CPUs." << std::endl;
+    std::cout << "Shadow mode (evaluates the policy off the critical path, nothing is blocked):" << std::endl;
+    std::cout << "    -I, --shadow-icloud <lvl>   Shadow block level for iCloud"         << std::endl;
+    std::cout << "    -D, --shadow-dropbox <lvl>  Shadow block level for Dropbox"        << std::endl;
+    std::cout << "    -r, --shadow-rate <1-100>   Percentage of events to be evaluated. Default is 100." << std::endl;
+    std::cout << "    If -i/-d block nothing, events are answered immediately (observe-only), otherwise shadow verdicts are compared with the enforced ones." << std::endl;
     std::cout << std::endl;
 }
 
 
 static const struct option longopts[] =
 {
-    { "icloud",      optional_argument, nullptr,    'i' },
-    { "dropbox",     optional_argument, nullptr,    'd' },
-    { "verbosity",   optional_argument, nullptr,    'v' },
-    { "help",        no_argument,       nullptr,    'h' },
-    { nullptr,       0,                 nullptr,     0  }
+    { "icloud",         optional_argument, nullptr,    'i' },
+    { "dropbox",        optional_argument, nullptr,    'd' },
+    { "verbosity",      optional_argument, nullptr,    'v' },
+    { "dry-run-scan",   required_argument, nullptr,    's' },
+    { "bundle-id",      required_argument, nullptr,    'b' },
+    { "operations",     required_argument, nullptr,    'o' },
+    { "home",           required_argument, nullptr,    'H' },
+    { "threads",        required_argument, nullptr,    'j' },
+    { "shadow-icloud",  required_argument, nullptr,    'I' },
+    { "shadow-dropbox", required_argument, nullptr,    'D' },
+    { "shadow-rate",    required_argument, nullptr,    'r' },
+    { "help",           no_argument,       nullptr,    'h' },
+    { nullptr,          0,                 nullptr,     0  }
 };
 
 
-bool parseArguments(const int argc, char * const argv[], bool &help, std::unordered_map<CloudProviderId, BlockLevel> &config)
+/// @param strict Reject unknown levels instead of falling back to "none", for runs which only report what would be blocked
+bool parseBlockLevel(const std::string &lvl, const CloudProviderId cp, const bool strict, BlockLevel &bl)
+{
+    if (lvl == "none")
+        bl = BlockLevel::NONE;
+    else if (lvl == "ronly")
+        bl = BlockLevel::RONLY;
+    else if (lvl == "full")
+        bl = BlockLevel::FULL;
+    else if (strict) {
+        Logger::getInstance().log(LogLevel::ERR, "Unsupported block level \"", lvl, "\" for ", g_cpToStr.at(cp), ".");
+        return false;
+    } else {
+        Logger::getInstance().log(LogLevel::ERR, "Unsupported block level. Setting: \"none\" for ", g_cpToStr.at(cp), ".");
+        bl = BlockLevel::NONE;
+    }
+    return true;
+}
+
+unsigned int parseShadowRate(const std::string &str)
+{
+    // std::stoul() silently wraps negative numbers and ignores trailing characters
+    size_t pos = 0;
+    unsigned long n = 0;
+    try {
+        if (!str.empty() && str[0] != '-')
+            n = std::stoul(str, &pos);
+    } catch (const std::logic_error &) {
+        // Not a number or out of range of unsigned long, reported below
+    }
+    if (pos != str.size() || n < 1 || n > 100)
+        throw std::invalid_argument("Shadow rate must be in range 1-100.");
+    return static_cast<unsigned int>(n);
+}
+
+bool parseArguments(const int argc, char * const argv[], bool &help, std::unordered_map<CloudProviderId, BlockLevel> &config,
+                    std::unordered_map<CloudProviderId, BlockLevel> &shadowConfig, unsigned int &shadowRate,
+                    std::string &scanRoot, std::string &homePath, DryRunScanner::Options &scanOpts)
 {
     Logger &logger = Logger::getInstance();
 
@@ -51,39 +111,51 @@ bool parseArguments(const int argc, char * const argv[], bool &help, std::unorde
     char opt = 0;
     std::string logLevel;
     std::unordered_map<CloudProviderId,std::string> blockLvls;
+    std::unordered_map<CloudProviderId,std::string> shadowBlockLvls;
+    bool shadowRateSet = false;
 
-    while((opt = getopt_long(argc, argv, "i:d:v:h", longopts, &optionIndex)) != -1)
-    {
-        switch (opt)
+    try {
+        while((opt = getopt_long(argc, argv, "i:d:v:s:b:o:H:j:I:D:r:h", longopts, &optionIndex)) != -1)
         {
-            case 0:                                                     break;
-            case 'i':   blockLvls[CloudProviderId::ICLOUD]  = optarg;   break;
-            case 'd':   blockLvls[CloudProviderId::DROPBOX] = optarg;   break;
-            case 'v':   logLevel  = optarg;   break;
-            case 'h':   help      = true;     return true;
-            default:                          return false;
+            switch (opt)
+            {
+                case 0:                                                     break;
+                case 'i':   blockLvls[CloudProviderId::ICLOUD]  = optarg;   break;
+                case 'd':   blockLvls[CloudProviderId::DROPBOX] = optarg;   break;
+                case 'v':   logLevel  = optarg;   break;
+                case 's':   scanRoot  = optarg;   break;
+                case 'b':   scanOpts.bundleIds.push_back(optarg);           break;
+                case 'o':   DryRunScanner::ParseOperations(optarg, scanOpts.operations); break;
+                case 'H':   homePath  = optarg;   break;
+                case 'j':   scanOpts.threads = DryRunScanner::ParseThreads(optarg); break;
+                case 'I':   shadowBlockLvls[CloudProviderId::ICLOUD]  = optarg;   break;
+                case 'D':   shadowBlockLvls[CloudProviderId::DROPBOX] = optarg;   break;
+                case 'r':   shadowRate = parseShadowRate(optarg); shadowRateSet = true; break;
+                case 'h':   help      = true;     return true;
+                default:                          return false;
+            }
         }
+    } catch (const std::exception &e) {
+        logger.log(LogLevel::ERR, "Invalid argument: ", e.what());
+        return false;
     }
 
     if (!logLevel.empty())
         logger.setLogLevel(logLevel);
 
-    for (const auto &[cp,lvl] : blockLvls) {
-        BlockLevel cpBlockLvl;
-        if (lvl == "none")
-            cpBlockLvl = BlockLevel::NONE;
-        else if (lvl == "ronly")
-            cpBlockLvl = BlockLevel::RONLY;
-        else if (lvl == "full")
-            cpBlockLvl = BlockLevel::FULL;
-        else {
-            logger.log(LogLevel::ERR, "Unsupported block level. Setting: \"none\" for ", g_cpToStr.at(cp), ".");
-            cpBlockLvl = BlockLevel::NONE;
-        }
-
-        config[cp] = cpBlockLvl;
+    if (shadowRateSet && shadowBlockLvls.empty()) {
+        logger.log(LogLevel::ERR, "Shadow rate (-r) requires a shadow cloud provider (-I/-D).");
+        return false;
     }
 
+    // Shadow and dry-run results with a silently dropped level would be misleading
+    for (const auto &[cp,lvl] : blockLvls)
+        if (!parseBlockLevel(lvl, cp, !scanRoot.empty(), config[cp]))
+            return false;
+    for (const auto &[cp,lvl] : shadowBlockLvls)
+        if (!parseBlockLevel(lvl, cp, true, shadowConfig[cp]))
+            return false;
+
     return true;
 }
 
@@ -103,7 +175,12 @@ int main(const int argc, char * const argv[])
 
         bool help = false;
         std::unordered_map<CloudProviderId, BlockLevel> config;
-        if (!parseArguments(argc, argv, help, config)) {
+        std::unordered_map<CloudProviderId, BlockLevel> shadowConfig;
+        unsigned int shadowRate = 100;
+        std::string scanRoot;
+        std::string homePath;
+        DryRunScanner::Options scanOpts;
+        if (!parseArguments(argc, argv, help, config, shadowConfig, shadowRate, scanRoot, homePath, scanOpts)) {
             printHelp();
             return EXIT_FAILURE;
         }
@@ -114,10 +191,24 @@ int main(const int argc, char * const argv[])
         }
 
         Blocker &blocker = Blocker::GetInstance();
+
+        // Dry-run scan does not need the ES client, just the configuration.
+        if (!scanRoot.empty()) {
+            // Only an explicit home folder may be a copy with cloud folders pointing elsewhere
+            if (!blocker.Configure(config, homePath, !homePath.empty()))
+                return EXIT_FAILURE;
+
+            blocker.DryRunScan(scanRoot, scanOpts);
+            return EXIT_SUCCESS;
+        }
+
         if (!blocker.Init())
             return EXIT_FAILURE;
 
-        if (!blocker.Configure(config))
+        if (!blocker.Configure(config, homePath))
+            return EXIT_FAILURE;
+
+        if (!shadowConfig.empty() && !blocker.ConfigureShadow(shadowConfig, shadowRate, homePath))
             return EXIT_FAILURE;
 
         CFRunLoopRun();
@@ -0,0 +1,67 @@
+//
+//  negativecache.cpp
+//  blockerd
+//
+//  Created by agent on 19/10/2026.
+//
+
+#include "negativecache.hpp"
+
+
+NegativeCache::Generation NegativeCache::CurrentGeneration() const
+{
+    Generation ret;
+    for (size_t i = 0; i < SHARDS; i++)
+        ret[i] = m_generations[i];
+    return ret;
+}
+
+bool NegativeCache::Contains(const uint64_t dev, const uint64_t ino)
+{
+    const Key key = {dev, ino};
+    Shard &shard = m_shards[GetShardIndex(key)];
+
+    std::scoped_lock<std::mutex> lock(shard.mtx);
+    return shard.keys.find(key) != shard.keys.end();
+}
+
+bool NegativeCache::Insert(const uint64_t dev, const uint64_t ino, const Generation &generation, size_t &evicted)
+{
+    const Key key = {dev, ino};
+    const size_t idx = GetShardIndex(key);
+    Shard &shard = m_shards[idx];
+    evicted = 0;
+
+    std::scoped_lock<std::mutex> lock(shard.mtx);
+    // The file may have been moved under a cloud folder since the event arrived.
+    // Erase() bumps the generation before taking the lock so it either sees this entry or we see the new generation.
+    if (m_generations[idx] != generation[idx])
+        return false;
+
+    if (shard.keys.size() >= m_shardCapacity && shard.keys.find(key) == shard.keys.end()) {
+        evicted = shard.keys.size();
+        shard.keys.clear();
+    }
+    return shard.keys.insert(key).second;
+}
+
+bool NegativeCache::Erase(const uint64_t dev, const uint64_t ino)
+{
+    const Key key = {dev, ino};
+    const size_t idx = GetShardIndex(key);
+    Shard &shard = m_shards[idx];
+
+    // Even if the key is not here yet, an insert of it may be in flight
+    m_generations[idx]++;
+    std::scoped_lock<std::mutex> lock(shard.mtx);
+    return shard.keys.erase(key) != 0;
+}
+
+void NegativeCache::Clear()
+{
+    for (size_t i = 0; i < SHARDS; i++) {
+        m_generations[i]++;
+        std::scoped_lock<std::mutex> lock(m_shards[i].mtx);
+        m_shards[i].keys.clear();
+    }
+}
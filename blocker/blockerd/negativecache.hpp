@@ -0,0 +1,77 @@
+//
+//  negativecache.hpp
+//  blockerd
+//
+//  Created by agent on 19/10/2026.
+//
+
+#ifndef negativecache_hpp
+#define negativecache_hpp
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <unordered_set>
+
+/// Bounded set of (st_dev, st_ino) pairs whose paths are known to lie outside
+/// of all configured cloud folders. It is split into shards, each with its own
+/// lock, and a full shard is simply flushed.
+///
+/// Entries are evaluated later than the events which invalidate them arrive.
+/// Every Erase() therefore bumps the generation of its shard (Clear() of all of them),
+/// and Insert() refuses entries evaluated from an event which arrived before
+/// the latest invalidation of the entry's shard.
+class NegativeCache
+{
+public:
+    static constexpr size_t SHARDS = 16;
+    /// Shared by caches which are invalidated together (their shards match)
+    using ShardGenerations = std::array<std::atomic<uint64_t>, SHARDS>;
+    /// Snapshot of ShardGenerations
+    using Generation = std::array<uint64_t, SHARDS>;
+
+private:
+    struct Key {
+        uint64_t dev = 0;
+        uint64_t ino = 0;
+
+        bool operator == (const Key &other) const { return dev == other.dev && ino == other.ino; }
+    };
+
+    struct KeyHash {
+        size_t operator () (const Key &key) const { return std::hash<uint64_t>()(key.ino ^ (key.dev << 32 | key.dev >> 32)); }
+    };
+
+    struct Shard {
+        std::unordered_set<Key, KeyHash> keys;
+        std::mutex mtx;
+    };
+
+    std::array<Shard, SHARDS> m_shards;
+    size_t m_shardCapacity;
+    ShardGenerations &m_generations;
+
+    static size_t GetShardIndex(const Key &key) { return KeyHash()(key) % SHARDS; }
+
+public:
+    NegativeCache(ShardGenerations &generations, const size_t capacity = 65536)
+        : m_shardCapacity(capacity / SHARDS), m_generations(generations) {};
+    ~NegativeCache() = default;
+    // delete copy operations
+    NegativeCache(const NegativeCache &) = delete;
+    void operator=(const NegativeCache &) = delete;
+
+    /// @return Generation to be passed to Insert(), take it when the event arrives
+    Generation CurrentGeneration() const;
+
+    bool Contains(const uint64_t dev, const uint64_t ino);
+    /// @param evicted Number of entries evicted to make room for the new one
+    /// @return True if the entry was not cached yet and it was inserted
+    bool Insert(const uint64_t dev, const uint64_t ino, const Generation &generation, size_t &evicted);
+    bool Erase(const uint64_t dev, const uint64_t ino);
+    void Clear();
+};
+
+#endif /* negativecache_hpp */
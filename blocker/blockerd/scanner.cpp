@@ -0,0 +1,375 @@
+//
+//  scanner.cpp
+//  blockerd
+//
+//  Created by agent on 19/10/2026.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include "scanner.hpp"
+
+namespace fs = std::filesystem;
+
+
+const std::unordered_map<ScanOperation, const std::string> g_scanOpToStr = {
+    {ScanOperation::READ,       "read"},
+    {ScanOperation::WRITE,      "write"},
+    {ScanOperation::COPY_OUT,   "copy-out"},
+    {ScanOperation::OPEN_READ,  "open-r"},
+    {ScanOperation::OPEN_WRITE, "open-w"},
+};
+
+const std::unordered_map<ScanVerdict, const std::string> g_scanVerdictToStr = {
+    {ScanVerdict::OUTSIDE,  "OUTSIDE"},
+    {ScanVerdict::ALLOW,    "ALLOW"},
+    {ScanVerdict::RESTRICT, "RESTRICT"},
+    {ScanVerdict::DENY,     "DENY"},
+};
+
+namespace {
+    // Per-worker queue of directories to be listed. The owner pops from the back
+    // (depth-first, good locality), idle workers steal from the front.
+    struct WorkQueue {
+        std::deque<std::string> dirs;
+        std::mutex mtx;
+    };
+}
+
+// MARK: - Public
+DryRunScanner::DryRunScanner(const std::vector<std::reference_wrapper<const CloudPolicy>> &policies, const Options &opts)
+    : m_policies(policies), m_opts(opts)
+{
+    if (m_opts.bundleIds.empty())
+        m_opts.bundleIds.push_back(""); // any non-whitelisted application
+    if (m_opts.operations.empty())
+        m_opts.operations = {
+            ScanOperation::READ,
+            ScanOperation::WRITE,
+            ScanOperation::COPY_OUT,
+            ScanOperation::OPEN_READ,
+            ScanOperation::OPEN_WRITE,
+        };
+    if (m_opts.threads == 0)
+        m_opts.threads = std::max(1u, std::thread::hardware_concurrency());
+    m_opts.threads = std::min(m_opts.threads, MAX_THREADS);
+}
+
+DryRunScanner::Report DryRunScanner::Scan(const std::string &root) const
+{
+    const auto start = std::chrono::steady_clock::now();
+    const unsigned int threadCnt = m_opts.threads;
+
+    const auto emptyReport = [&]() {
+        Report r;
+        r.bundleIds = m_opts.bundleIds;
+        r.operations = m_opts.operations;
+        r.tallies.resize(m_opts.bundleIds.size() * m_opts.operations.size());
+        return r;
+    };
+
+    std::vector<WorkQueue> queues(threadCnt);
+    std::vector<Report> reports(threadCnt, emptyReport());
+    // Directories which are queued or being listed. Zero means we are done.
+    std::atomic<uint64_t> pending {0};
+    // Directories which are queued only, idle workers sleep until there are some.
+    std::atomic<uint64_t> queued {0};
+    std::atomic<unsigned int> idle {0};
+    std::mutex idleMtx;
+    std::condition_variable idleCv;
+
+    std::error_code ec;
+    const fs::file_status rootStatus = fs::symlink_status(root, ec);
+    if (ec) {
+        reports[0].errors++;
+    } else {
+        EvaluatePath(root, reports[0]);
+        if (fs::is_directory(rootStatus)) {
+            reports[0].directories++;
+            pending = 1;
+            queued = 1;
+            queues[0].dirs.push_back(root);
+        } else {
+            reports[0].files++;
+        }
+    }
+
+    const auto popWork = [&](const unsigned int self, std::string &dir) {
+        {
+            std::scoped_lock<std::mutex> lock(queues[self].mtx);
+            if (!queues[self].dirs.empty()) {
+                dir = std::move(queues[self].dirs.back());
+                queues[self].dirs.pop_back();
+                queued--;
+                return true;
+            }
+        }
+        for (unsigned int i = 1; i < threadCnt; i++) {
+            WorkQueue &victim = queues[(self + i) % threadCnt];
+            std::scoped_lock<std::mutex> lock(victim.mtx);
+            if (!victim.dirs.empty()) {
+                dir = std::move(victim.dirs.front());
+                victim.dirs.pop_front();
+                queued--;
+                return true;
+            }
+        }
+        return false;
+    };
+
+    // Both counters are changed before the check of idle workers and a sleeping
+    // worker checks them after it announced itself, so no wakeup is lost.
+    // Taking the lock orders the notification after the sleeper's predicate check.
+    const auto wakeIdle = [&](const bool all) {
+        if (idle == 0)
+            return;
+        { std::scoped_lock<std::mutex> lock(idleMtx); }
+        if (all)
+            idleCv.notify_all();
+        else
+            idleCv.notify_one();
+    };
+
+    const auto waitForWork = [&]() {
+        std::unique_lock<std::mutex> lock(idleMtx);
+        idle++;
+        idleCv.wait(lock, [&]{ return queued != 0 || pending == 0; });
+        idle--;
+    };
+
+    const auto worker = [&](const unsigned int self) {
+        Report &report = reports[self];
+        std::string dir;
+
+        while (true) {
+            if (!popWork(self, dir)) {
+                if (pending == 0)
+                    return;
+                waitForWork();
+                continue;
+            }
+
+            std::error_code ec;
+            for (fs::directory_iterator it(dir, fs::directory_options::skip_permission_denied, ec), end;
+                 !ec && it != end;
+                 it.increment(ec)) {
+                const std::string &path = it->path().native();
+                EvaluatePath(path, report);
+
+                // Do not follow symlinks, we could escape the scanned tree or loop.
+                std::error_code ecStatus;
+                if (it->is_directory(ecStatus) && !it->is_symlink(ecStatus)) {
+                    report.directories++;
+                    pending++;
+                    {
+                        std::scoped_lock<std::mutex> lock(queues[self].mtx);
+                        queues[self].dirs.push_back(path);
+                    }
+                    queued++;
+                    wakeIdle(false);
+                } else {
+                    report.files++;
+                }
+
+                if (ecStatus)
+                    report.errors++;
+            }
+
+            if (ec)
+                report.errors++;
+            if (--pending == 0)
+                wakeIdle(true);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned int i = 0; i < threadCnt; i++)
+        workers.emplace_back(worker, i);
+    for (auto &t : workers)
+        t.join();
+
+    Report ret = emptyReport();
+    for (auto &r : reports)
+        Merge(ret, r);
+
+    // Every path of such provider is reported as OUTSIDE, which is most likely not intended.
+    for (const auto &cp : m_policies)
+        if (!HasRootUnder(cp, root))
+            ret.providersWithoutRoot.push_back(cp.get().id);
+
+    ret.threads = threadCnt;
+    ret.elapsedUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    return ret;
+}
+
+void DryRunScanner::ParseOperations(const std::string &list, std::vector<ScanOperation> &operations)
+{
+    std::istringstream iss(list);
+    std::string opStr;
+    while (std::getline(iss, opStr, ',')) {
+        const auto it = std::find_if(g_scanOpToStr.begin(), g_scanOpToStr.end(),
+                                     [&](const auto &op) { return op.second == opStr; });
+        if (it == g_scanOpToStr.end())
+            throw std::invalid_argument("Unsupported operation \"" + opStr + "\".");
+        operations.push_back(it->first);
+    }
+}
+
+unsigned int DryRunScanner::ParseThreads(const std::string &str)
+{
+    // std::stoul() silently wraps negative numbers and ignores trailing characters
+    size_t pos = 0;
+    unsigned long n = 0;
+    try {
+        if (!str.empty() && str[0] != '-')
+            n = std::stoul(str, &pos);
+    } catch (const std::logic_error &) {
+        // Not a number or out of range of unsigned long, reported below
+    }
+    if (pos != str.size() || n < 1 || n > MAX_THREADS)
+        throw std::invalid_argument("Number of threads must be in range 1-" + std::to_string(MAX_THREADS) + ".");
+    return static_cast<unsigned int>(n);
+}
+
+std::ostream & operator << (std::ostream &out, const DryRunScanner::Report &report)
+{
+    const uint64_t entries = report.files + report.directories;
+
+    out << "--- DRY-RUN SCAN REPORT ---";
+    out << std::endl << "Files: " << report.files;
+    out << std::endl << "Directories: " << report.directories;
+    out << std::endl << "Errors: " << report.errors;
+    out << std::endl << "Threads: " << report.threads;
+    out << std::endl << "Elapsed: " << report.elapsedUs / 1000 << "." << std::setfill('0') << std::setw(3) << report.elapsedUs % 1000 << std::setfill(' ') << " ms (";
+    // Too fast to be measured
+    if (report.elapsedUs == 0)
+        out << "n/a";
+    else
+        out << entries * 60000000 / report.elapsedUs;
+    out << " paths/min)";
+    for (const auto &cpId : report.providersWithoutRoot)
+        out << std::endl << "WARNING: No " << g_cpToStr.at(cpId) << " folder in the scanned tree.";
+
+    for (size_t b = 0; b < report.bundleIds.size(); b++) {
+        for (size_t o = 0; o < report.operations.size(); o++) {
+            const std::string &bundleId = report.bundleIds[b];
+            out << std::endl << " -- " << (bundleId.empty() ? "(any app)" : bundleId)
+                << " " << g_scanOpToStr.at(report.operations[o]) << ":";
+
+            const auto &tallies = report.tallies[b * report.operations.size() + o];
+            for (size_t v = 0; v < tallies.size(); v++) {
+                out << std::endl << g_scanVerdictToStr.at(static_cast<ScanVerdict>(v)) << ": " << tallies[v].count;
+                // Paths outside of clouds are not interesting
+                if (static_cast<ScanVerdict>(v) == ScanVerdict::OUTSIDE)
+                    continue;
+                for (const auto &sample : tallies[v].samples)
+                    out << std::endl << "    " << sample;
+            }
+        }
+    }
+    return out;
+}
+
+
+// MARK: - Private
+bool DryRunScanner::HasRootUnder(const CloudPolicy &cp, const std::string &root) const
+{
+    // Either the cloud folder is inside of the scanned tree or the scanned tree is inside of it
+    for (const auto &cpPath : cp.paths)
+        if (cpPath.compare(0, root.size(), root) == 0 || root.compare(0, cpPath.size(), cpPath) == 0)
+            return true;
+    return false;
+}
+
+void DryRunScanner::EvaluatePath(const std::string &path, Report &report) const
+{
+    const std::vector<std::string> eventPaths = { path };
+
+    // Same as CloudBlocker::ResolveCloudProvider()
+    std::vector<std::pair<std::reference_wrapper<const CloudPolicy>, std::vector<std::string>>> cpPaths;
+    for (const auto &cp : m_policies) {
+        std::vector<std::string> tmp = cp.get().FilterCloudFolders(eventPaths);
+        if (!tmp.empty())
+            cpPaths.emplace_back(cp, std::move(tmp));
+    }
+
+    const size_t opCnt = m_opts.operations.size();
+    for (size_t b = 0; b < m_opts.bundleIds.size(); b++) {
+        for (size_t o = 0; o < opCnt; o++) {
+            // As in CloudBlocker::HandleEventImpl() the most restrictive cloud provider wins.
+            ScanVerdict verdict = ScanVerdict::OUTSIDE;
+            try {
+                for (const auto &[cp,paths] : cpPaths)
+                    verdict = std::max(verdict, Evaluate(cp, paths, m_opts.bundleIds[b], m_opts.operations[o]));
+            } catch (...) {
+                // The ES handler answers such events with the default response, we just count them.
+                report.errors++;
+                continue;
+            }
+
+            Report::Tally &tally = report.tallies[b * opCnt + o][static_cast<size_t>(verdict)];
+            tally.count++;
+            if (verdict != ScanVerdict::OUTSIDE)
+                AddSample(tally, path);
+        }
+    }
+}
+
+ScanVerdict DryRunScanner::Evaluate(const CloudPolicy &cp, const std::vector<std::string> &cpPaths,
+                                    const std::string &bundleId, const ScanOperation op) const
+{
+    uint32_t fflags = FFLAG_READ;
+
+    switch (op) {
+        case ScanOperation::READ:
+            return (cp.AuthReadGeneral(bundleId) ? ScanVerdict::ALLOW : ScanVerdict::DENY);
+        case ScanOperation::WRITE:
+            return (cp.AuthWriteGeneral(bundleId, cpPaths) ? ScanVerdict::ALLOW : ScanVerdict::DENY);
+        case ScanOperation::COPY_OUT:
+            return (cp.AuthWriteGeneral(bundleId, cpPaths, true) ? ScanVerdict::ALLOW : ScanVerdict::DENY);
+        case ScanOperation::OPEN_WRITE:
+            fflags |= FFLAG_WRITE;
+            [[fallthrough]];
+        case ScanOperation::OPEN_READ:
+        {
+            const uint32_t allowed = cp.AuthOpen(bundleId, cpPaths, fflags);
+            if (allowed == fflags)
+                return ScanVerdict::ALLOW;
+            return (allowed == 0 ? ScanVerdict::DENY : ScanVerdict::RESTRICT);
+        }
+    }
+    return ScanVerdict::ALLOW;
+}
+
+void DryRunScanner::AddSample(Report::Tally &tally, const std::string &path) const
+{
+    if (tally.samples.size() < m_opts.samplesPerVerdict)
+        tally.samples.push_back(path);
+}
+
+void DryRunScanner::Merge(Report &dst, Report &src) const
+{
+    dst.files       += src.files;
+    dst.directories += src.directories;
+    dst.errors      += src.errors;
+
+    for (size_t i = 0; i < dst.tallies.size(); i++) {
+        for (size_t v = 0; v < dst.tallies[i].size(); v++) {
+            Report::Tally &d = dst.tallies[i][v];
+            Report::Tally &s = src.tallies[i][v];
+            d.count += s.count;
+            for (auto &sample : s.samples)
+                AddSample(d, sample);
+        }
+    }
+}
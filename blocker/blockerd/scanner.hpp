@@ -0,0 +1,105 @@
+//
+//  scanner.hpp
+//  blockerd
+//
+//  Created by agent on 19/10/2026.
+//
+
+#ifndef scanner_hpp
+#define scanner_hpp
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Clouds/policy.hpp"
+
+// Dry-run scanner walks a directory tree and evaluates every path with the same
+// matcher and policy as the ES handler. It uses only the standard library so it
+// can be run against copies of user folders on other systems as well.
+
+enum class ScanOperation : uint8_t
+{
+    READ,       //!< READDIR, READLINK, CHDIR
+    WRITE,      //!< CREATE, RENAME, UNLINK, LINK, TRUNCATE, ...
+    COPY_OUT,   //!< CLONE with the destination outside of the cloud
+    OPEN_READ,  //!< OPEN with FREAD
+    OPEN_WRITE, //!< OPEN with FREAD | FWRITE
+};
+
+enum class ScanVerdict : uint8_t
+{
+    OUTSIDE,    //!< Path is not in any cloud folder
+    ALLOW,
+    RESTRICT,   //!< Only some of the requested open flags are allowed
+    DENY,
+    _COUNT,
+};
+
+extern const std::unordered_map<ScanOperation, const std::string> g_scanOpToStr;
+extern const std::unordered_map<ScanVerdict, const std::string> g_scanVerdictToStr;
+
+class DryRunScanner
+{
+public:
+    static constexpr unsigned int MAX_THREADS = 256;
+
+    struct Options {
+        std::vector<std::string> bundleIds;
+        std::vector<ScanOperation> operations;
+        unsigned int threads      = 0;  // 0 = std::thread::hardware_concurrency(), at most MAX_THREADS
+        size_t samplesPerVerdict  = 5;
+    };
+
+    struct Report {
+        struct Tally {
+            uint64_t count = 0;
+            std::vector<std::string> samples;
+        };
+        using VerdictTallies = std::array<Tally, static_cast<size_t>(ScanVerdict::_COUNT)>;
+
+        std::vector<std::string> bundleIds;
+        std::vector<ScanOperation> operations;
+        // Indexed by [bundleId * operations.size() + operation]
+        std::vector<VerdictTallies> tallies;
+        // Configured cloud providers without any cloud folder in the scanned tree
+        std::vector<CloudProviderId> providersWithoutRoot;
+        uint64_t files       = 0;
+        uint64_t directories = 0;
+        uint64_t errors      = 0;
+        uint64_t elapsedUs   = 0;
+        unsigned int threads = 0;
+    };
+
+private:
+    std::vector<std::reference_wrapper<const CloudPolicy>> m_policies;
+    Options m_opts;
+
+    bool HasRootUnder(const CloudPolicy &cp, const std::string &root) const;
+    void EvaluatePath(const std::string &path, Report &report) const;
+    ScanVerdict Evaluate(const CloudPolicy &cp, const std::vector<std::string> &cpPaths,
+                         const std::string &bundleId, const ScanOperation op) const;
+    void AddSample(Report::Tally &tally, const std::string &path) const;
+    void Merge(Report &dst, Report &src) const;
+
+public:
+    DryRunScanner(const std::vector<std::reference_wrapper<const CloudPolicy>> &policies, const Options &opts);
+    ~DryRunScanner() = default;
+    // delete copy operations
+    DryRunScanner(const DryRunScanner &) = delete;
+    void operator=(const DryRunScanner &) = delete;
+
+    Report Scan(const std::string &root) const;
+
+    // Command line helpers shared by the front ends, throw std::invalid_argument
+    static void ParseOperations(const std::string &list, std::vector<ScanOperation> &operations);
+    static unsigned int ParseThreads(const std::string &str);
+};
+
+std::ostream & operator << (std::ostream &out, const DryRunScanner::Report &report);
+
+#endif /* scanner_hpp */
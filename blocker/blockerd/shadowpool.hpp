@@ -0,0 +1,58 @@
+//
+//  shadowpool.hpp
+//  blockerd
+//
+//  Created by agent on 19/10/2026.
+//
+
+#ifndef shadowpool_hpp
+#define shadowpool_hpp
+
+#include <any>
+#include <condition_variable>
+#include <deque>
+#include <EndpointSecurity/EndpointSecurity.h>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "negativecache.hpp"
+
+/// Bounded pool of low priority threads evaluating copies of ES messages
+/// off the critical path. When the queue is full, new messages are rejected.
+class ShadowPool
+{
+public:
+    using Handler = std::function<void(const es_message_t * const msg, const std::any &enforced, const NegativeCache::Generation &cacheGeneration)>;
+
+private:
+    struct Job {
+        es_message_t *msg = nullptr;
+        std::any enforced;  // empty if the event was not enforced
+        NegativeCache::Generation cacheGeneration {};
+    };
+
+    std::deque<Job> m_queue;
+    size_t m_capacity = 0;
+    bool m_stop = false;
+    std::mutex m_mtx;
+    std::condition_variable m_cv;
+    std::vector<std::thread> m_workers;
+    Handler m_handler;
+
+    void Worker();
+
+public:
+    ShadowPool() = default;
+    ~ShadowPool();
+    // delete copy operations
+    ShadowPool(const ShadowPool &) = delete;
+    void operator=(const ShadowPool &) = delete;
+
+    bool Start(const unsigned int threads, const size_t capacity, Handler handler);
+    void Stop();
+    bool Push(const es_message_t * const msg, const std::any &enforced, const NegativeCache::Generation &cacheGeneration);
+};
+
+#endif /* shadowpool_hpp */
@@ -0,0 +1,117 @@
+//
+//  shadowpool.mm
+//  blockerd
+//
+//  Created by agent on 19/10/2026.
+//
+
+#include <pthread/qos.h>    // pthread_set_qos_class_self_np()
+
+#include "../../Common/logger.hpp"
+#include "shadowpool.hpp"
+
+
+static Logger &g_logger = Logger::getInstance();
+
+// MARK: - Public
+ShadowPool::~ShadowPool()
+{
+    Stop();
+}
+
+bool ShadowPool::Start(const unsigned int threads, const size_t capacity, Handler handler)
+{
+    std::scoped_lock<std::mutex> lock(m_mtx);
+    if (!m_workers.empty()) {
+        g_logger.log(LogLevel::ERR, DEBUG_ARGS, "Shadow pool is already running.");
+        return false;
+    }
+
+    m_capacity = capacity;
+    m_handler = std::move(handler);
+    m_stop = false;
+    for (unsigned int i = 0; i < threads; i++)
+        m_workers.emplace_back(&ShadowPool::Worker, this);
+
+    return true;
+}
+
+void ShadowPool::Stop()
+{
+    std::vector<std::thread> workers;
+    {
+        std::scoped_lock<std::mutex> lock(m_mtx);
+        m_stop = true;
+        workers.swap(m_workers);
+    }
+    m_cv.notify_all();
+
+    for (auto &t : workers)
+        t.join();
+
+    // Whatever was not evaluated is thrown away
+    std::scoped_lock<std::mutex> lock(m_mtx);
+    for (auto &job : m_queue)
+        es_free_message(job.msg);
+    m_queue.clear();
+}
+
+bool ShadowPool::Push(const es_message_t * const msg, const std::any &enforced, const NegativeCache::Generation &cacheGeneration)
+{
+    const auto accepting = [this]() {
+        return !m_stop && !m_workers.empty() && m_queue.size() < m_capacity;
+    };
+
+    // Check before copying the message so we do not waste time under pressure
+    {
+        std::scoped_lock<std::mutex> lock(m_mtx);
+        if (!accepting())
+            return false;
+    }
+
+    es_message_t *msgCopy = es_copy_message(msg);
+    if (msgCopy == nullptr)
+        return false;
+
+    {
+        std::scoped_lock<std::mutex> lock(m_mtx);
+        // Stop() or other producers could have come in between
+        if (!accepting()) {
+            es_free_message(msgCopy);
+            return false;
+        }
+        m_queue.push_back({msgCopy, enforced, cacheGeneration});
+    }
+    m_cv.notify_one();
+    return true;
+}
+
+
+// MARK: - Private
+void ShadowPool::Worker()
+{
+    // Do not compete with the threads responding to the kernel
+    pthread_set_qos_class_self_np(QOS_CLASS_BACKGROUND, 0);
+
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mtx);
+            m_cv.wait(lock, [this]{ return m_stop || !m_queue.empty(); });
+            if (m_stop)
+                return;
+
+            job = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+
+        try {
+            m_handler(job.msg, job.enforced, job.cacheGeneration);
+        } catch (const std::exception &e) {
+            g_logger.log(LogLevel::ERR, DEBUG_ARGS, e.what());
+        } catch (...) {
+            g_logger.log(LogLevel::ERR, DEBUG_ARGS, "Unknown exception!");
+        }
+        es_free_message(job.msg);
+    }
+}
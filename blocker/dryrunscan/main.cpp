@@ -0,0 +1,150 @@
+//
+//  main.cpp
+//  dryrunscan
+//
+//  Created by agent on 19/10/2026.
+//
+//  Dry-run scanner without EndpointSecurity and Foundation, so it can be run
+//  against copies of user folders on other systems (e.g. Linux).
+
+
+#include <cstdlib>
+#include <getopt.h>
+#include <iostream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "../blockerd/scanner.hpp"
+#include "../blockerd/Clouds/policy.hpp"
+
+
+void printHelp()
+{
+    std::cout << "Usage: dryrunscan  <cloud_provider> <block_level> [...] -H <home> [-b <bundle_id>] [-o <operations>] [-j <threads>] <root>" << std::endl;
+    std::cout << "    -h, --help                  Print usage."                                      << std::endl;
+    std::cout << "Supported Cloud Providers:"                                                        << std::endl;
+    std::cout << "    -i, --icloud <lvl>          iCloud"                                            << std::endl;
+    std::cout << "    -d, --dropbox <lvl>         Dropbox"                                           << std::endl;
+    std::cout << "Block Levels:"                                                                     << std::endl;
+    std::cout << "    none, ronly, full"                                                             << std::endl;
+    std::cout << "Options:"                                                                          << std::endl;
+    std::cout << "    -H, --home <path>           Home folder used to find cloud folders (e.g. a copy of user's folder)." << std::endl;
+    std::cout << "    -b, --bundle-id <id>        Application to be evaluated (repeatable). Default is any non-whitelisted app." << std::endl;
+    std::cout << "    -o, --operations <list>     Comma separated list of read,write,copy-out,open-r,open-w. Default is all." << std::endl;
+    std::cout << "    -j, --threads <1-256>       Number of scanning threads. Default is the number of CPUs." << std::endl;
+    std::cout << std::endl;
+}
+
+
+static const struct option longopts[] =
+{
+    { "icloud",         required_argument, nullptr,    'i' },
+    { "dropbox",        required_argument, nullptr,    'd' },
+    { "home",           required_argument, nullptr,    'H' },
+    { "bundle-id",      required_argument, nullptr,    'b' },
+    { "operations",     required_argument, nullptr,    'o' },
+    { "threads",        required_argument, nullptr,    'j' },
+    { "help",           no_argument,       nullptr,    'h' },
+    { nullptr,          0,                 nullptr,     0  }
+};
+
+
+BlockLevel parseBlockLevel(const std::string &lvl)
+{
+    if (lvl == "none")
+        return BlockLevel::NONE;
+    else if (lvl == "ronly")
+        return BlockLevel::RONLY;
+    else if (lvl == "full")
+        return BlockLevel::FULL;
+
+    // Unlike blockerd, do not fall back to "none" as the whole report would be misleading
+    throw std::invalid_argument("Unsupported block level \"" + lvl + "\".");
+}
+
+bool parseArguments(const int argc, char * const argv[], bool &help, std::unordered_map<CloudProviderId, BlockLevel> &config,
+                    std::string &scanRoot, std::string &homePath, DryRunScanner::Options &scanOpts)
+{
+    int optionIndex = 0;
+    int opt = 0;
+    try {
+        while((opt = getopt_long(argc, argv, "i:d:H:b:o:j:h", longopts, &optionIndex)) != -1)
+        {
+            switch (opt)
+            {
+                case 0:                                                                          break;
+                case 'i':   config[CloudProviderId::ICLOUD]  = parseBlockLevel(optarg);          break;
+                case 'd':   config[CloudProviderId::DROPBOX] = parseBlockLevel(optarg);          break;
+                case 'H':   homePath  = optarg;                                                  break;
+                case 'b':   scanOpts.bundleIds.push_back(optarg);                                break;
+                case 'o':   DryRunScanner::ParseOperations(optarg, scanOpts.operations);         break;
+                case 'j':   scanOpts.threads = DryRunScanner::ParseThreads(optarg);              break;
+                case 'h':   help      = true;     return true;
+                default:                          return false;
+            }
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Invalid argument: " << e.what() << std::endl;
+        return false;
+    }
+
+    if (optind != argc - 1) {
+        std::cerr << "Exactly one directory tree has to be scanned." << std::endl;
+        return false;
+    }
+    scanRoot = argv[optind];
+
+    // There is no active (console) user to fall back to
+    if (homePath.empty()) {
+        std::cerr << "Home folder (-H) is required." << std::endl;
+        return false;
+    }
+    while (homePath.size() > 1 && homePath.back() == '/')
+        homePath.pop_back();
+
+    return true;
+}
+
+
+
+int main(const int argc, char * const argv[])
+{
+    bool help = false;
+    std::unordered_map<CloudProviderId, BlockLevel> config;
+    std::string scanRoot;
+    std::string homePath;
+    DryRunScanner::Options scanOpts;
+    if (!parseArguments(argc, argv, help, config, scanRoot, homePath, scanOpts)) {
+        printHelp();
+        return EXIT_FAILURE;
+    }
+
+    if (help) {
+        printHelp();
+        return EXIT_SUCCESS;
+    }
+
+    // Same as CloudBlocker::LoadConfig()
+    std::vector<CloudPolicy> policies;
+    for (const auto &[cpId, blkLvl] : config) {
+        std::string error;
+        CloudPolicy cp;
+        cp.id = cpId;
+        cp.bl = blkLvl;
+        cp.paths = FindCloudFolders(cpId, homePath, error);
+        cp.allowedBundleIds = g_cpAllowedBundleIds.at(cpId);
+
+        if (cp.paths.empty())
+            std::cerr << "Could not set " << g_cpToStr.at(cpId) << " paths: " << error << std::endl;
+        for (const auto &path : cp.paths)
+            std::cerr << g_cpToStr.at(cpId) << ": Path set to \"" << path << "\"." << std::endl;
+
+        policies.push_back(std::move(cp));
+    }
+
+    std::vector<std::reference_wrapper<const CloudPolicy>> policyRefs(policies.begin(), policies.end());
+    DryRunScanner scanner(policyRefs, scanOpts);
+    std::cout << scanner.Scan(scanRoot) << std::endl;
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,194 @@
+/**
+ *  @file       negativecache_test.cpp
+ *  @brief      Tests of blockerd's NegativeCache, build and run with `make test` in dryrunscan
+ *  @author     agent <agent@local>
+ *  @date
+ *   - Created: 19.10.2026
+ *  @version    1.0.0
+ *  @par        make: GNU Make 3.81
+ *  @bug
+ *  @todo
+ */
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "../blockerd/negativecache.hpp"
+
+static int g_failures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK failed: " #cond << std::endl; \
+            g_failures++; \
+        } \
+    } while (0)
+
+
+static void testInsertErase()
+{
+    NegativeCache::ShardGenerations generations {};
+    NegativeCache cache(generations);
+    size_t evicted = 0;
+
+    CHECK(!cache.Contains(1, 1));
+    CHECK(cache.Insert(1, 1, cache.CurrentGeneration(), evicted));
+    CHECK(evicted == 0);
+    CHECK(cache.Contains(1, 1));
+    CHECK(!cache.Insert(1, 1, cache.CurrentGeneration(), evicted));
+    CHECK(cache.Erase(1, 1));
+    CHECK(!cache.Contains(1, 1));
+    CHECK(!cache.Erase(1, 1));
+}
+
+static void testStaleGeneration()
+{
+    NegativeCache::ShardGenerations generations {};
+    NegativeCache cache(generations);
+    size_t evicted = 0;
+
+    // The key was invalidated after the event arrived, even though it was not cached yet
+    const NegativeCache::Generation generation = cache.CurrentGeneration();
+    CHECK(!cache.Erase(1, 1));
+    CHECK(!cache.Insert(1, 1, generation, evicted));
+    CHECK(!cache.Contains(1, 1));
+    CHECK(cache.Insert(1, 1, cache.CurrentGeneration(), evicted));
+}
+
+static void testOtherShardsUnaffected()
+{
+    NegativeCache::ShardGenerations generations {};
+    NegativeCache cache(generations);
+    size_t evicted = 0;
+
+    // Only keys in the shard of the erased one are refused
+    const NegativeCache::Generation generation = cache.CurrentGeneration();
+    cache.Erase(1, 1);
+    size_t inserted = 0;
+    size_t refused = 0;
+    for (uint64_t ino = 2; ino < 2 + 16 * NegativeCache::SHARDS; ino++) {
+        if (cache.Insert(1, ino, generation, evicted))
+            inserted++;
+        else
+            refused++;
+    }
+    CHECK(inserted > 0);
+    CHECK(refused > 0);
+    CHECK(refused < inserted);
+}
+
+static void testSharedGenerations()
+{
+    NegativeCache::ShardGenerations generations {};
+    NegativeCache cache(generations);
+    NegativeCache shadowCache(generations);
+    size_t evicted = 0;
+
+    // Both caches are invalidated by the same events
+    const NegativeCache::Generation generation = cache.CurrentGeneration();
+    cache.Erase(1, 1);
+    CHECK(!shadowCache.Insert(1, 1, generation, evicted));
+
+    const NegativeCache::Generation generationBeforeClear = shadowCache.CurrentGeneration();
+    cache.Clear();
+    for (uint64_t ino = 0; ino < 4 * NegativeCache::SHARDS; ino++)
+        CHECK(!shadowCache.Insert(1, ino, generationBeforeClear, evicted));
+}
+
+static void testEviction()
+{
+    NegativeCache::ShardGenerations generations {};
+    NegativeCache cache(generations, NegativeCache::SHARDS);    // one entry per shard
+    size_t evicted = 0;
+    size_t evictedTotal = 0;
+
+    for (uint64_t ino = 0; ino < 8 * NegativeCache::SHARDS; ino++) {
+        CHECK(cache.Insert(1, ino, cache.CurrentGeneration(), evicted));
+        evictedTotal += evicted;
+    }
+    CHECK(evictedTotal > 0);
+    CHECK(cache.Contains(1, 8 * NegativeCache::SHARDS - 1));
+}
+
+/// Evaluation thread: takes the generation when the event arrives, finds the file outside
+/// of cloud folders and caches it. Rename thread: moves the file under a cloud folder and erases it.
+/// Whatever the interleaving, the moved file must not stay cached.
+static void testInsertEraseRace()
+{
+    constexpr int ITERATIONS = 20000;
+    int stale = 0;
+
+    for (int i = 0; i < ITERATIONS; i++) {
+        NegativeCache::ShardGenerations generations {};
+        NegativeCache cache(generations);
+        std::atomic<bool> moved {false};
+
+        std::thread evaluation([&]() {
+            const NegativeCache::Generation generation = cache.CurrentGeneration();
+            if (!moved) {
+                size_t evicted = 0;
+                cache.Insert(1, 1, generation, evicted);
+            }
+        });
+        std::thread rename([&]() {
+            moved = true;
+            cache.Erase(1, 1);
+        });
+        evaluation.join();
+        rename.join();
+
+        if (cache.Contains(1, 1))
+            stale++;
+    }
+    CHECK(stale == 0);
+}
+
+/// Mainly for ThreadSanitizer
+static void testConcurrentAccess()
+{
+    constexpr uint64_t KEYS = 1024;
+    NegativeCache::ShardGenerations generations {};
+    NegativeCache cache(generations, KEYS / 2);
+
+    std::vector<std::thread> threads;
+    for (unsigned int t = 0; t < 4; t++) {
+        threads.emplace_back([&cache, t]() {
+            size_t evicted = 0;
+            for (uint64_t i = 0; i < 50000; i++) {
+                const uint64_t ino = (i * 7 + t) % KEYS;
+                switch ((i + t) % 8) {
+                    case 0:     cache.Erase(1, ino);                                        break;
+                    case 1:     cache.Contains(1, ino);                                     break;
+                    default:    cache.Insert(1, ino, cache.CurrentGeneration(), evicted);   break;
+                }
+            }
+            if (t == 0)
+                cache.Clear();
+        });
+    }
+    for (auto &thread : threads)
+        thread.join();
+}
+
+
+int main()
+{
+    testInsertErase();
+    testStaleGeneration();
+    testOtherShardsUnaffected();
+    testSharedGenerations();
+    testEviction();
+    testInsertEraseRace();
+    testConcurrentAccess();
+
+    if (g_failures) {
+        std::cerr << g_failures << " check(s) failed." << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "All negative cache tests passed." << std::endl;
+    return EXIT_SUCCESS;
+}